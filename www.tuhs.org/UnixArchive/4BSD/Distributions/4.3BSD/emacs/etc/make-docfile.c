@@ -27,10 +27,31 @@ copyright notice and this notice must be preserved on all copies.  */
  Each entry starts with a ^_ character.
  Then comes the function name, terminated with a newline.
  Then comes the documentation for that function.
+
+ After the last entry comes an index of them all: a ^_ and a newline,
+ then a line for each entry giving the function name, the position in
+ the file where its documentation starts and the length of that
+ documentation, separated by spaces.  Emacs uses the index to find a
+ doc string without searching for the ^_ that ends it.
  */
 
 #include <stdio.h>
 
+/* Number of chars output so far */
+long out_pos;
+
+/* The name of each entry output so far, and where its documentation starts */
+struct entry
+  {
+    char *name;
+    long pos;
+  };
+
+struct entry *entries;
+int nentries, entries_size;
+
+char *malloc (), *realloc ();
+
 main (argc, argv)
      int argc;
      char **argv;
@@ -40,9 +61,66 @@ main (argc, argv)
 
   for (i = 1; i < argc; i++)
     err_count += scan_file (argv[i]);	/* err_count seems to be {mis,un}used */
+  write_index ();
   exit (err_count);			/* see below - shane */
 }
 
+put_char (c)
+     int c;
+{
+  putchar (c);
+  out_pos++;
+}
+
+/* Output the start of an entry for function NAME,
+ and record it for the index.  */
+
+start_entry (name)
+     char *name;
+{
+  if (nentries == entries_size)
+    {
+      entries_size = 2 * entries_size + 500;
+      entries = (struct entry *)
+	(entries ? realloc (entries, entries_size * sizeof *entries)
+	 : malloc (entries_size * sizeof *entries));
+      if (!entries)
+	{
+	  fprintf (stderr, "make-docfile: virtual memory exhausted\n");
+	  exit (1);
+	}
+    }
+  put_char (037);
+  printf ("%s\n", name);
+  out_pos += strlen (name) + 1;
+  entries[nentries].name = malloc (strlen (name) + 1);
+  strcpy (entries[nentries].name, name);
+  entries[nentries++].pos = out_pos;
+}
+
+/* Output the index of all the entries.
+ Each entry's documentation ends at the ^_ that starts the next entry,
+ or that starts the index.  */
+
+write_index ()
+{
+  register int i;
+  register long end;
+  long index_pos = out_pos;
+
+  put_char (037);
+  put_char ('\n');
+  for (i = 0; i < nentries; i++)
+    {
+      if (i + 1 < nentries)
+	end = entries[i + 1].pos - strlen (entries[i + 1].name) - 2;
+      else
+	end = index_pos;
+      printf ("%s %ld %ld\n", entries[i].name, entries[i].pos,
+	      end - entries[i].pos);
+    }
+}
+
 /* Read file FILENAME and output its doc strings to stdout.  */
 /* Return 1 if file is not found, 0 if it is found.  */
 
@@ -93,7 +171,7 @@ read_c_string (infile, printflag)
 		c = '\t';
 	    }
 	  if (printflag > 0)
-	    putchar (c);
+	    put_char (c);
 	  else if (printflag < 0)
 	    *p++ = c;
 	  c = getc (infile);
@@ -102,7 +180,7 @@ read_c_string (infile, printflag)
       if (c != '"')
 	break;
       if (printflag > 0)
-	putchar (c);
+	put_char (c);
       else if (printflag < 0)
 	*p++ = c;
       c = getc (infile);
@@ -189,8 +267,7 @@ scan_c_file (filename)
 
       if (c == '"')
 	{
-	  putchar (037);
-	  puts (buf);
+	  start_entry (buf);
 	  read_c_string (infile, 1, 0);
 	}
     }
@@ -343,8 +420,7 @@ scan_lisp_file (filename)
       if (c != '\n')
 	continue;
 
-      putchar (037);
-      puts (buf);
+      start_entry (buf);
       read_c_string (infile, 1, 0);
     }
   fclose (infile);
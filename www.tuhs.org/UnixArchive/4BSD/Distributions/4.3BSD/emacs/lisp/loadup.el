@@ -85,6 +85,15 @@
       (add-name-to-file "xemacs" (concat "emacs-" emacs-version) t)
       (kill-emacs)))
 
+;; "pdump" writes the Lisp state instead, for  emacs -pdump emacs.pdmp.
+;; This works even where CANNOT_DUMP is defined.
+(if (or (equal (nth 3 command-line-args) "pdump")
+	(equal (nth 4 command-line-args) "pdump"))
+    (progn
+      (message "Dumping Lisp state to emacs.pdmp")
+      (dump-emacs-portable "emacs.pdmp")
+      (kill-emacs)))
+
 ;; Avoid error if user loads some more libraries now.
 (setq purify-flag nil)
 
@@ -29,16 +29,55 @@ and this notice must be preserved on all copies.  */
 /* Number of bytes of consing done since the last gc */
 int consing_since_gc;
 
-/* Number of bytes of consing since gc before another gc should be done. */
+/* Least number of bytes of consing since gc before another gc should be done. */
 int gc_cons_threshold;
 
+/* Number of bytes of consing since gc at which the next gc will be done.
+ set_gc_trigger computes this after each collection.  */
+int gc_trigger;
+
+/* The trigger is at least this percentage of the live heap.  */
+int gc_cons_percentage;
+
+/* If positive, the number of milliseconds a minor collection should take.  */
+int gc_pause_target;
+
+/* Collect garbage while waiting for input if consing has reached
+ this percentage of the trigger.  Zero means never do so.  */
+int gc_idle_percentage;
+
+/* Approximate number of bytes of Lisp data found live by the last gc.  */
+int gc_live_bytes;
+
 /* Nonzero during gc */
 int gc_in_progress;
 
+/* Bytes of allocation left before the allocation profiler takes a sample.
+ While the profiler is not running, this is too big ever to run out.  */
+int alloc_sample_countdown;
+
+#define ALLOC_SAMPLE_NEVER (1 << 30)
+
+/* Types of object the allocation profiler counts separately */
+#define ALLOC_CONS 0
+#define ALLOC_VECTOR 1
+#define ALLOC_STRING 2
+#define ALLOC_SYMBOL 3
+#define ALLOC_MARKER 4
+#define ALLOC_TYPES 5
+
+static void sample_allocation ();
+
+/* Count `nbytes' of allocation of an object of type `type'
+ towards the allocation profiler's next sample.  */
+#define PROFILE_ALLOC(type, nbytes) \
+  if ((alloc_sample_countdown -= (nbytes)) < 0) \
+    sample_allocation (type, nbytes)
+
 #ifndef VIRT_ADDR_VARIES
 /* Address below which pointers should not be traced */
 extern char edata[];
-#endif /* VIRT_ADDR_VARIES */
+#endif /* not VIRT_ADDR_VARIES */
 
 #ifndef VIRT_ADDR_VARIES
 extern
@@ -53,9 +92,48 @@ extern
 /* Non-nil means defun should do purecopy on the function definition */
 Lisp_Object Vpurify_flag;
 
-int pure[PURESIZE / sizeof (int)] = {0,};   /* Force it into data space! */
+#ifdef VIRT_ADDR_VARIES
+#ifdef HAVE_MMAP
+/* Pure storage is a range of address space reserved at startup.
+ Segments of it are made usable one at a time as pure objects need
+ them, so PURESIZE does not limit the Lisp code that can be preloaded.  */
+#define PURE_SEGMENTS
+#endif /* HAVE_MMAP */
+#endif /* VIRT_ADDR_VARIES */
+
+#ifdef PURE_SEGMENTS
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#ifndef MAP_ANON
+#define MAP_ANON MAP_ANONYMOUS
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+/* Bytes of address space to reserve for pure storage */
+#ifndef PURE_RESERVE
+#define PURE_RESERVE (1 << 26)
+#endif
+
+/* Pure storage grows by this many bytes at a time */
+#define PURE_SEGMENT_SIZE (1 << 18)
 
-#define PUREBEG (char *) pure
+/* Address at which to ask for pure storage to be put.  If it is the
+ same each time, a dumped pure image can be used without relocation.  */
+#ifndef PURE_ADDRESS
+#define PURE_ADDRESS 0
+#endif
+
+#else /* not PURE_SEGMENTS */
+LISP_WORD pure[PURESIZE / sizeof (LISP_WORD)] = {0,};   /* Force it into data space! */
+#endif /* not PURE_SEGMENTS */
+
+/* Pure storage starts at pure_base, and pure_size bytes of it are usable.
+ PURE_P considers everything from pure_base up to pure_limit to be pure.  */
+char *pure_base, *pure_limit;
+int pure_size;
 
 /* Index in pure at which next pure object will be allocated. */
 int pureptr;
@@ -105,32 +183,110 @@ xrealloc (block, size)
 
 /* Allocation of cons cells */
 /* We store cons cells inside of cons_blocks, allocating a new
- cons_block with malloc whenever necessary.  Cons cells reclaimed by
+ cons_block whenever necessary.  Cons cells reclaimed by
  GC are put on a free list to be reallocated before allocating
  any new cons cells from the latest cons_block.
 
- Each cons_block is just under 1020 bytes long,
- since malloc really allocates in units of powers of two
- and uses 4 bytes for its own overhead. */
+ Each cons_block is CONS_BLOCK_BYTES long and aligned on a multiple
+ of that, so the block that holds a cons can be found from its address.
+ They are cut out of larger chunks obtained with malloc.
+
+ The conses of a block from index `young_from' on were made since the
+ last garbage collection; they are the young generation.
+ `dirty' is set in a block when a cons in it that might be older
+ than that is changed to point at something else; see remember_cons.
+ A cons taken from the free list is young too.  Its bit is set in
+ `recycled', and its block is put on the chain of recycled_blocks.  */
+
+#define CONS_BLOCK_BYTES 1024
+#define CONS_CHUNK_BLOCKS 16
+
+/* Bytes for one bit per cons; a little more than needed.  */
+#define CONS_RECYCLED_BYTES (CONS_BLOCK_BYTES / sizeof (struct Lisp_Cons) / 8 + 1)
+
+struct cons_block_head
+  {
+    struct cons_block *next;
+    struct cons_block *next_recycled;
+    int young_from;
+    int dirty;
+    int any_recycled;
+    unsigned char recycled[CONS_RECYCLED_BYTES];
+  };
 
 #define CONS_BLOCK_SIZE \
-  ((1020 - sizeof (struct cons_block *)) / sizeof (struct Lisp_Cons))
+  ((CONS_BLOCK_BYTES - sizeof (struct cons_block_head)) / sizeof (struct Lisp_Cons))
 
 struct cons_block
   {
     struct cons_block *next;
+    struct cons_block *next_recycled;
+    int young_from;
+    int dirty;
+    int any_recycled;
+    unsigned char recycled[CONS_RECYCLED_BYTES];
     struct Lisp_Cons conses[CONS_BLOCK_SIZE];
   };
 
+#define CONS_BLOCK_OF(ptr) \
+  ((struct cons_block *) ((LISP_WORD) (ptr) & ~(LISP_WORD) (CONS_BLOCK_BYTES - 1)))
+
+#define CONS_INDEX(ptr) ((ptr) - CONS_BLOCK_OF (ptr)->conses)
+
+/* Nonzero if the cons at ptr was taken from the free list
+   since the last garbage collection */
+#define RECYCLED_CONS_P(ptr) \
+  (CONS_BLOCK_OF (ptr)->recycled[CONS_INDEX (ptr) >> 3] & (1 << (CONS_INDEX (ptr) & 7)))
+
+/* Nonzero if the cons at ptr was made since the last garbage collection */
+#define YOUNG_CONS_P(ptr) \
+  (CONS_INDEX (ptr) >= CONS_BLOCK_OF (ptr)->young_from || RECYCLED_CONS_P (ptr))
+
+/* The cdr of a cons on the free list is set to this,
+   so that GC can tell free conses from those in use.  */
+#define FREE_CONS_P(ptr) (XTYPE ((ptr)->cdr) == Lisp_Void)
+#define SET_FREE_CONS(ptr) XSET ((ptr)->cdr, Lisp_Void, 0)
+
 struct cons_block *cons_block;
 int cons_block_index;
 
 struct Lisp_Cons *cons_free_list;
 
+/* Blocks with conses taken from the free list since the last
+   garbage collection, chained through next_recycled.  */
+static struct cons_block *recycled_blocks;
+
+/* Return a new, empty cons block.  */
+
+static struct cons_block *
+make_cons_block ()
+{
+  static char *chunk;
+  static int chunk_blocks;
+  register struct cons_block *new;
+
+  if (chunk_blocks == 0)
+    {
+      chunk = (char *) malloc ((CONS_CHUNK_BLOCKS + 1) * CONS_BLOCK_BYTES);
+      if (!chunk) memory_full ();
+      chunk = (char *) (((LISP_WORD) chunk + CONS_BLOCK_BYTES - 1)
+			& ~(LISP_WORD) (CONS_BLOCK_BYTES - 1));
+      chunk_blocks = CONS_CHUNK_BLOCKS;
+    }
+  new = (struct cons_block *) chunk;
+  chunk += CONS_BLOCK_BYTES;
+  chunk_blocks--;
+  new->young_from = 0;
+  new->dirty = 0;
+  new->any_recycled = 0;
+  bzero (new->recycled, sizeof new->recycled);
+  return new;
+}
+
 void
 init_cons ()
 {
-  cons_block = (struct cons_block *) malloc (sizeof (struct cons_block));
+  cons_block = make_cons_block ();
   cons_block->next = 0;
   bzero (cons_block->conses, sizeof cons_block->conses);
   cons_block_index = 0;
@@ -142,9 +298,44 @@ free_cons (ptr)
      struct Lisp_Cons *ptr;
 {
   XSETCONS (ptr->car, cons_free_list);
+  SET_FREE_CONS (ptr);
   cons_free_list = ptr;
 }
 
+/* Call this after storing into the car or cdr of `cell',
+   unless `cell' was made since the last garbage collection.
+   A minor collection looks for pointers to young objects
+   only in the old conses of blocks recorded this way.  */
+
+remember_cons (cell)
+     Lisp_Object cell;
+{
+  if (PURE_P (cell))
+    return;
+  CONS_BLOCK_OF (XCONS (cell))->dirty = 1;
+}
+
+/* Record that the cons at `ptr', just taken from the free list, is young.  */
+
+static void
+recycle_cons (ptr)
+     register struct Lisp_Cons *ptr;
+{
+  register struct cons_block *cblk = CONS_BLOCK_OF (ptr);
+  register int i = ptr - cblk->conses;
+
+  /* Conses made since the last collection are young already.  */
+  if (i >= cblk->young_from)
+    return;
+  cblk->recycled[i >> 3] |= 1 << (i & 7);
+  if (!cblk->any_recycled)
+    {
+      cblk->any_recycled = 1;
+      cblk->next_recycled = recycled_blocks;
+      recycled_blocks = cblk;
+    }
+}
+
 DEFUN ("cons", Fcons, Scons, 2, 2, 0,
   "Create a new cons, give it CAR and CDR as components, and return it.")
   (car, cdr)
@@ -156,13 +347,13 @@ DEFUN ("cons", Fcons, Scons, 2, 2, 0,
     {
       XSET (val, Lisp_Cons, cons_free_list);
       cons_free_list = XCONS (cons_free_list->car);
+      recycle_cons (XCONS (val));
     }
   else
     {
       if (cons_block_index == CONS_BLOCK_SIZE)
 	{
-	  register struct cons_block *new = (struct cons_block *) malloc (sizeof (struct cons_block));
-	  if (!new) memory_full ();
+	  register struct cons_block *new = make_cons_block ();
 	  new->next = cons_block;
 	  cons_block = new;
 	  cons_block_index = 0;
@@ -172,6 +363,7 @@ DEFUN ("cons", Fcons, Scons, 2, 2, 0,
   XCONS (val)->car = car;
   XCONS (val)->cdr = cdr;
   consing_since_gc += sizeof (struct Lisp_Cons);
+  PROFILE_ALLOC (ALLOC_CONS, sizeof (struct Lisp_Cons));
   return val;
 }
 
@@ -200,15 +392,40 @@ DEFUN ("make-list", Fmake_list, Smake_list, 2, 2, 0,
      Lisp_Object length, init;
 {
   register Lisp_Object val;
-  register int size;
+  register int size, n;
+  register struct Lisp_Cons *ptr;
 
   if (XTYPE (length) != Lisp_Int || XINT (length) < 0)
     length = wrong_type_argument (Qnatnump, length);
   size = XINT (length);
 
   val = Qnil;
-  while (size-- > 0)
-    val = Fcons (init, val);
+  while (size > 0)
+    {
+      if (cons_free_list || cons_block_index == CONS_BLOCK_SIZE)
+	{
+	  val = Fcons (init, val);
+	  size--;
+	  continue;
+	}
+      /* Take as many conses as are wanted, and left,
+	 from the current block in one go.  */
+      n = CONS_BLOCK_SIZE - cons_block_index;
+      if (n > size)
+	n = size;
+      ptr = &cons_block->conses[cons_block_index];
+      cons_block_index += n;
+      size -= n;
+      consing_since_gc += n * sizeof (struct Lisp_Cons);
+      PROFILE_ALLOC (ALLOC_CONS, n * sizeof (struct Lisp_Cons));
+      while (n-- > 0)
+	{
+	  ptr->car = init;
+	  ptr->cdr = val;
+	  XSET (val, Lisp_Cons, ptr);
+	  ptr++;
+	}
+    }
   return val;
 }
 
@@ -241,6 +458,8 @@ DEFUN ("make-vector", Fmake_vector, Smake_vector, 2, 2, 0,
   for (index = 0; index < sizei; index++)
     XVECTOR (vector)->contents[index] = init;
 
+  PROFILE_ALLOC (ALLOC_VECTOR,
+		 sizeof (struct Lisp_Vector) + (sizei - 1) * sizeof (Lisp_Object));
   return vector;
 }
 
@@ -325,7 +544,10 @@ Its value and function definition are void, and its property list is NIL.")
   XSYMBOL (val)->value = Qunbound;
   XSYMBOL (val)->function = Qunbound;
   XSYMBOL (val)->next = 0;
+  XSYMBOL (val)->local_index = 0;
+  remember_store (val, str);
   consing_since_gc += sizeof (struct Lisp_Symbol);
+  PROFILE_ALLOC (ALLOC_SYMBOL, sizeof (struct Lisp_Symbol));
   return val;
 }
 
@@ -384,48 +606,159 @@ DEFUN ("make-marker", Fmake_marker, Smake_marker, 0, 0, 0,
   XMARKER (val)->modified = 0;
   XMARKER (val)->chain = Qnil;
   consing_since_gc += sizeof (struct Lisp_Marker);
+  PROFILE_ALLOC (ALLOC_MARKER, sizeof (struct Lisp_Marker));
   return val;
 }
 
 /* Allocation of strings */
 
-/* Strings reside inside of string_blocks.  The entire data of the string,
- both the size and the contents, live in part of the `chars' component of a string_block.
- The `pos' component is the index within `chars' of the first free byte */
+/* Strings are never moved once made.  The entire data of a string,
+ both the size and the contents, live together.  A string whose
+ full size, counting the size word and the terminating null, is at most
+ STRING_SMALL_MAX bytes lives in a slot of a string_slab; all the slots
+ of a slab are the same size, one of the size classes in string_class_size.
+ Free slots are chained through their size words onto the free list
+ for their class.  A bigger string is malloc'd by itself, after a
+ large_string_head, and is freed by itself.
 
-/* String blocks contain this many bytes.
-  Power of 2, minus 4 for malloc overhead. */
-#define STRING_BLOCK_SIZE (8188 - sizeof (struct string_block_head))
+ The flags of a string are kept outside it: in the `flags' byte
+ for its slot in its slab, or in its large_string_head.
+ STRING_IN_USE says a slot holds a string; STRING_MARKED is the gc mark;
+ STRING_YOUNG says the string was made since the last garbage collection.  */
 
-/* A string bigger than this gets its own specially-made string block
- if it doesn't fit in the current one. */
-#define STRING_BLOCK_OUTSIZE 1024
+#define STRING_IN_USE 1
+#define STRING_MARKED 2
+#define STRING_YOUNG 4
 
-struct string_block_head
+/* Each string_slab is STRING_SLAB_BYTES long and aligned on a multiple
+ of that, so the slab that holds a string can be found from its address.
+ They are cut out of larger chunks obtained with malloc.  */
+
+#define STRING_SLAB_BYTES 8192
+#define STRING_CHUNK_SLABS 8
+
+#define STRING_SMALL_MAX 1024
+#define STRING_CLASSES 13
+
+static int string_class_size[STRING_CLASSES] =
+  { 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+
+/* Element n is the smallest class whose slots hold n LISP_WORDs.  */
+static char string_class_of[STRING_SMALL_MAX / sizeof (LISP_WORD) + 1];
+
+struct string_slab
   {
-    struct string_block *next;
-    int pos;
+    struct string_slab *next;	/* Chain of all slabs */
+    int class;			/* Index in string_class_size */
+    int slot_size;		/* Bytes in each slot */
+    int nslots;
+    int young;			/* Number of young strings in this slab */
+    char *slots;		/* Address of the first slot */
+    unsigned char flags[1];	/* One per slot; really nslots of them */
   };
 
-struct string_block
+#define STRING_SLAB_OF(ptr) \
+  ((struct string_slab *) ((LISP_WORD) (ptr) & ~(LISP_WORD) (STRING_SLAB_BYTES - 1)))
+
+/* Its size is a multiple of that of a pointer, and so of a LISP_WORD;
+ the string follows it directly.  */
+
+struct large_string_head
   {
-    struct string_block *next;
-    int pos;
-    char chars[STRING_BLOCK_SIZE];
+    struct large_string_head *next;
+    unsigned char flags;
   };
 
-/* This points to the string block we are now allocating strings in
- which is also the beginning of the chain of all string blocks ever made */
+#define LARGE_STRING_OF(ptr) ((struct large_string_head *) (ptr) - 1)
+
+/* Number of bytes used by a string of `length' chars:
+ the size word, the chars and a null, rounded up to a multiple of the size word.  */
+#define STRING_FULLSIZE(length) \
+  (((length) + 2 * sizeof (LISP_WORD)) & ~(sizeof (LISP_WORD) - 1))
 
-struct string_block *current_string_block;
+struct string_slab *string_slabs;
+
+static struct Lisp_String *string_free_list[STRING_CLASSES];
+
+/* Large strings that have survived a garbage collection,
+ and those made since the last one.  */
+
+struct large_string_head *large_strings, *young_large_strings;
 
 void
 init_strings ()
 {
-  current_string_block = (struct string_block *) malloc (sizeof (struct string_block));
-  consing_since_gc += sizeof (struct string_block);
-  current_string_block->next = 0;
-  current_string_block->pos = 0;
+  register int n, class = 0;
+
+  for (n = 0; n <= STRING_SMALL_MAX / sizeof (LISP_WORD); n++)
+    {
+      while (string_class_size[class] < n * sizeof (LISP_WORD))
+	class++;
+      string_class_of[n] = class;
+    }
+  for (class = 0; class < STRING_CLASSES; class++)
+    string_free_list[class] = 0;
+  string_slabs = 0;
+  large_strings = young_large_strings = 0;
+}
+
+/* Make a slab of strings of class `class' and put its slots on the free list.  */
+
+static void
+make_string_slab (class)
+     int class;
+{
+  static char *chunk;
+  static int chunk_slabs;
+  register struct string_slab *new;
+  register int size = string_class_size[class];
+  register int i;
+
+  if (chunk_slabs == 0)
+    {
+      chunk = (char *) malloc ((STRING_CHUNK_SLABS + 1) * STRING_SLAB_BYTES);
+      if (!chunk) memory_full ();
+      chunk = (char *) (((LISP_WORD) chunk + STRING_SLAB_BYTES - 1)
+			& ~(LISP_WORD) (STRING_SLAB_BYTES - 1));
+      chunk_slabs = STRING_CHUNK_SLABS;
+    }
+  new = (struct string_slab *) chunk;
+  chunk += STRING_SLAB_BYTES;
+  chunk_slabs--;
+
+  new->class = class;
+  new->slot_size = size;
+  new->nslots = (STRING_SLAB_BYTES - sizeof (struct string_slab)
+		 - sizeof (LISP_WORD)) / (size + 1);
+  new->young = 0;
+  new->slots = (char *) (((LISP_WORD) &new->flags[new->nslots]
+			  + sizeof (LISP_WORD) - 1)
+			 & ~(LISP_WORD) (sizeof (LISP_WORD) - 1));
+  bzero (new->flags, new->nslots);
+  new->next = string_slabs;
+  string_slabs = new;
+
+  for (i = new->nslots - 1; i >= 0; i--)
+    {
+      register struct Lisp_String *s
+	= (struct Lisp_String *) (new->slots + i * size);
+      s->size = (LISP_WORD) string_free_list[class];
+      string_free_list[class] = s;
+    }
+}
+
+/* Return the address of the flags of the string at `s'.  */
+
+static unsigned char *
+string_flags (s)
+     register struct Lisp_String *s;
+{
+  register struct string_slab *slab;
+
+  if (STRING_FULLSIZE (s->size) > STRING_SMALL_MAX)
+    return &LARGE_STRING_OF (s)->flags;
+  slab = STRING_SLAB_OF (s);
+  return &slab->flags[((char *) s - slab->slots) / slab->slot_size];
 }
 
 static Lisp_Object make_zero_string ();
@@ -466,47 +799,44 @@ make_zero_string (length, init)
      register int init;
 {
   register Lisp_Object val;
-  register int fullsize = length + sizeof (int);
+  register int fullsize;
   register unsigned char *p, *end;
 
   if (length < 0) abort ();
 
-  /* Round `fullsize' up to multiple of size of int; also add one for terminating zero */
-  fullsize += sizeof (int);
-  fullsize &= ~(sizeof (int) - 1);
+  fullsize = STRING_FULLSIZE (length);
 
-  if (fullsize <= STRING_BLOCK_SIZE - current_string_block->pos)
-    /* This string can fit in the current string block */
-    {
-      XSET (val, Lisp_String,
-	    (struct Lisp_String *) (current_string_block->chars + current_string_block->pos));
-      current_string_block->pos += fullsize;
-    }
-  else if (fullsize > STRING_BLOCK_OUTSIZE)
-    /* This string gets its own string block */
+  if (fullsize <= STRING_SMALL_MAX)
+    /* Take a slot of the smallest class that holds this string */
     {
-      struct string_block *new = (struct string_block *) malloc (sizeof (struct string_block_head) + fullsize);
-      if (!new) memory_full ();
-      consing_since_gc += sizeof (struct string_block_head) + fullsize;
-      new->pos = fullsize;
-      new->next = current_string_block->next;
-      current_string_block->next = new;
-      XSET (val, Lisp_String,
-	    (struct Lisp_String *) ((struct string_block_head *)new + 1));
+      register int class = string_class_of[fullsize / sizeof (LISP_WORD)];
+      register struct Lisp_String *s;
+      register struct string_slab *slab;
+
+      if (!string_free_list[class])
+	make_string_slab (class);
+      s = string_free_list[class];
+      string_free_list[class] = (struct Lisp_String *) s->size;
+      slab = STRING_SLAB_OF (s);
+      slab->flags[((char *) s - slab->slots) / slab->slot_size]
+	= STRING_IN_USE | STRING_YOUNG;
+      slab->young++;
+      consing_since_gc += slab->slot_size;
+      XSET (val, Lisp_String, s);
     }
   else
-    /* Make a new current string block and start it off with this string */
+    /* This string gets a piece of memory of its own */
     {
-      struct string_block *new = (struct string_block *) malloc (sizeof (struct string_block));
+      register struct large_string_head *new
+	= (struct large_string_head *) malloc (sizeof (struct large_string_head) + fullsize);
       if (!new) memory_full ();
-      consing_since_gc += sizeof (struct string_block);
-      new->next = current_string_block;
-      current_string_block = new;
-      new->pos = fullsize;
-      XSET (val, Lisp_String,
-	    (struct Lisp_String *) current_string_block->chars);
+      consing_since_gc += sizeof (struct large_string_head) + fullsize;
+      new->flags = STRING_IN_USE | STRING_YOUNG;
+      new->next = young_large_strings;
+      young_large_strings = new;
+      XSET (val, Lisp_String, (struct Lisp_String *) (new + 1));
     }
-    
+
   XSTRING (val)->size = length;
   p = XSTRING (val)->data;
   end = p + XSTRING (val)->size;
@@ -514,30 +844,95 @@ make_zero_string (length, init)
     *p++ = init;
   *p = 0;
 
+  PROFILE_ALLOC (ALLOC_STRING, fullsize);
   return val;
 }
-
-/* Must get an error if pure storage is full,
+
+/* Make pure storage at least `nbytes' long, by making more segments
+ of the reserved space usable.  Return zero if this is not possible.  */
+
+static int
+grow_pure (nbytes)
+     int nbytes;
+{
+#ifdef PURE_SEGMENTS
+  int new_size = (nbytes + PURE_SEGMENT_SIZE - 1)
+		 / PURE_SEGMENT_SIZE * PURE_SEGMENT_SIZE;
+
+  if (new_size > PURE_RESERVE
+      || mprotect (pure_base + pure_size, new_size - pure_size,
+		   PROT_READ | PROT_WRITE) < 0)
+    return 0;
+  pure_size = new_size;
+  pure_limit = pure_base + pure_size;
+  return 1;
+#else /* not PURE_SEGMENTS */
+  return nbytes <= pure_size;
+#endif /* not PURE_SEGMENTS */
+}
+
+/* Return the address of `size' bytes of pure storage.
+ Must get an error if pure storage is full,
  since if it cannot hold a large string
  it may be able to hold conses that point to that string;
  then the string is not protected from gc. */
 
+static char *
+pure_alloc (size)
+     int size;
+{
+  register char *p;
+
+  /* Keep pure storage aligned for the conses and vectors after this.  */
+  size = (size + sizeof (Lisp_Object) - 1)
+	 / sizeof (Lisp_Object) * sizeof (Lisp_Object);
+  if (pureptr + size > pure_size && !grow_pure (pureptr + size))
+    error ("Pure Lisp storage exhausted");
+  p = pure_base + pureptr;
+  pureptr += size;
+  return p;
+}
+
+/* Fill pure storage, which must still be empty, with the `nbytes' bytes
+ at `offset' in the file open on `fd'.  Where pure storage is made of
+ segments, the file is mapped copy-on-write, so that all the Emacs
+ processes started from it share the pages that none of them changes;
+ `offset' must then be a multiple of the page size.
+ Return 0 if successful, -1 if not.  */
+
+int
+map_pure_file (fd, offset, nbytes)
+     int fd;
+     long offset;
+     int nbytes;
+{
+  if (pureptr != 0 || !grow_pure (nbytes))
+    return -1;
+#ifdef PURE_SEGMENTS
+  if (nbytes > 0
+      && mmap (pure_base, nbytes, PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_FIXED, fd, (off_t) offset) == (char *) -1)
+    return -1;
+#else /* not PURE_SEGMENTS */
+  if (lseek (fd, offset, 0) < 0
+      || read (fd, pure_base, nbytes) != nbytes)
+    return -1;
+#endif /* not PURE_SEGMENTS */
+  pureptr = nbytes;
+  return 0;
+}
+
 Lisp_Object
 make_pure_string (data, length)
      char *data;
      int length;
 {
   Lisp_Object new;
-  int size = sizeof (int) + length + 1;
 
-  if (pureptr + size > PURESIZE)
-    error ("Pure Lisp storage exhausted");
-  XSET (new, Lisp_String, PUREBEG + pureptr);
+  XSET (new, Lisp_String, pure_alloc (sizeof (LISP_WORD) + length + 1));
   XSTRING (new)->size = length;
   bcopy (data, XSTRING (new)->data, length);
   XSTRING (new)->data[length] = 0;
-  pureptr += (size + sizeof (int) - 1)
-	     / sizeof (int) * sizeof (int);
   return new;
 }
 
@@ -547,10 +942,7 @@ pure_cons (car, cdr)
 {
   Lisp_Object new;
 
-  if (pureptr + sizeof (struct Lisp_Cons) > PURESIZE)
-    error ("Pure Lisp storage exhausted");
-  XSET (new, Lisp_Cons, PUREBEG + pureptr);
-  pureptr += sizeof (struct Lisp_Cons);
+  XSET (new, Lisp_Cons, pure_alloc (sizeof (struct Lisp_Cons)));
   XCONS (new)->car = Fpurecopy (car);
   XCONS (new)->cdr = Fpurecopy (cdr);
   return new;
@@ -563,11 +955,7 @@ make_pure_vector (len)
   Lisp_Object new;
   int size = sizeof (struct Lisp_Vector) + (len - 1) * sizeof (Lisp_Object);
 
-  if (pureptr + size > PURESIZE)
-    error ("Pure Lisp storage exhausted");
-
-  XSET (new, Lisp_Vector, PUREBEG + pureptr);
-  pureptr += size;
+  XSET (new, Lisp_Vector, pure_alloc (size));
   XVECTOR (new)->size = len;
   return new;
 }
@@ -582,15 +970,9 @@ Does not copy symbols.")
   Lisp_Object new, tem;
   int i;
 
-#ifndef VIRT_ADDR_VARIES
   /* Need not trace pointers to pure storage */
-  if (XUINT (obj) < (unsigned int) edata && XUINT (obj) >= 0)
-    return obj;
-#else /* VIRT_ADDR_VARIES */
-  if (XUINT (obj) < (unsigned int) ((char *) pure + PURESIZE)
-      && XUINT (obj) >= (unsigned int) pure)
+  if (PURE_P (obj))
     return obj;
-#endif /* VIRT_ADDR_VARIES */
 
 #ifdef SWITCH_ENUM_BUG
   switch ((int) XTYPE (obj))
@@ -666,44 +1048,229 @@ struct backtrace
 
 extern struct backtrace *backtrace_list;
 
-/* On vector, means it has been marked.
- On string, means it has been copied.  */
+/* On vector, means it has been marked.  */
 static int most_negative_fixnum;
 
-/* On string, means do not copy it.
- This is set in all copies, and perhaps will be used
- to indicate strings that there is no need to copy.  */
-static int dont_copy_flag;
 
+/* Weak hash tables found by mark_object, chained through next_weak.  */
+static Lisp_Object weak_hash_tables;
+
 int total_conses, total_markers, total_symbols, total_string_size, total_vector_size;
 int total_free_conses, total_free_markers, total_free_symbols;
 
-/* Garbage collection: mark and sweep, except copy strings. */
+/* Nonzero during a minor collection.
+ A minor collection frees only conses and strings made since the
+ previous collection; those that survive become old.  Everything that
+ is not a cons or string is treated as old.  The old objects that can
+ point at young ones are scanned as roots; see mark_old_generation.  */
+static int gc_minor;
+
+/* Symbols and vectors that have been changed to point at young conses
+ or strings since the last collection; see remember_store.
+ If the table cannot be made bigger, remembered_overflow is set
+ and the next minor collection scans every symbol and vector.  */
+static Lisp_Object *remembered;
+static int remembered_count, remembered_size;
+static int remembered_overflow;
+
+/* Windows and processes.  The C code stores into their slots
+ all over, so every minor collection scans them.  */
+static Lisp_Object *always_remembered;
+static int always_remembered_count, always_remembered_size;
+
+/* The C variables that DefLispVar made Lisp variables of.
+ The C code sets many of them directly, so every minor collection
+ scans them too.  */
+static Lisp_Object **forwarded_vars;
+static int forwarded_vars_count, forwarded_vars_size;
+
+/* all_vectors as of the last collection.
+ The vectors before it on the chain are young, and are scanned.  */
+static struct Lisp_Vector *old_vectors;
+
+/* Maximum number of minor collections between major ones.
+ Zero means every collection is a major one.  */
+int gc_minors_per_major;
+
+/* Number of minor collections since the last major one.  */
+static int minors_since_major;
+
+/* Pause times of minor (element 0) and major (element 1) collections.
+ Element i of each counts pauses shorter than 2**i milliseconds;
+ the last element counts all longer ones.  */
+#define GC_PAUSE_BUCKETS 12
+static int gc_pauses[2][GC_PAUSE_BUCKETS];
+
+/* The mark stack.
+ Each entry is a run of `count' Lisp_Object slots starting at `slot'
+ that remain to be marked.  Marking an object pushes the run of slots
+ inside it, rather than recursing on the C stack, so deeply nested
+ structure cannot overflow that stack.
+
+ The mark stack grows as needed, up to MARK_STACK_MAX entries.
+ If it can grow no further, the run is dropped and
+ mark_stack_overflowed is set; since the object that holds those slots
+ has been marked, rescan_marked_objects will find it and push them again.  */
+
+#define MARK_STACK_MAX (1 << 18)
+
+struct mark_entry
+  {
+    Lisp_Object *slot;
+    int count;
+  };
+
+static struct mark_entry *mark_stack;
+static int mark_stack_size;
+static int mark_stack_depth;
+static int mark_stack_overflowed;
+
+/* Statistics on the mark phase of the last collection:
+ how long it took in microseconds, the greatest depth of the mark stack,
+ and the number of times the mark stack overflowed.  */
+int gc_mark_usecs, gc_mark_max_depth, gc_mark_overflows;
+
+/* Fetch the object at address `addr' into the cache ahead of need.  */
+#if defined (__GNUC__) && __GNUC__ >= 3
+#define PREFETCH(addr) __builtin_prefetch ((char *) (addr))
+#else
+#define PREFETCH(addr)
+#endif
+
+/* Garbage collection: mark and sweep. */
 static Lisp_Object mark_object ();
-static void clear_marks (), gc_sweep ();
+static void clear_marks (), gc_sweep (), sweep_strings ();
+static void mark_roots (), mark_old_generation (), mark_old_object (), gc_sweep_young ();
+static void prune_always_remembered ();
+static void rescan_marked_objects ();
+static Lisp_Object gc_pause_vector ();
 
 DEFUN ("garbage-collect", Fgarbage_collect, Sgarbage_collect, 0, 0, "",
   "Reclaim storage for Lisp objects no longer needed.\n\
 Returns info on amount of space in use:\n\
  ((USED-CONSES . FREE-CONSES) (USED-SYMS . FREE-SYMS)\n\
-  (USED-MARKERS . FREE-MARKERS) USED-STRING-CHARS USED-VECTOR-SLOTS)\n\
+  (USED-MARKERS . FREE-MARKERS) USED-STRING-CHARS USED-VECTOR-SLOTS\n\
+  MINOR-PAUSES MAJOR-PAUSES)\n\
+MINOR-PAUSES and MAJOR-PAUSES are vectors counting the collections of\n\
+each kind by how long they took: element I counts those that took\n\
+less than 2**I milliseconds, and the last element counts the rest.\n\
 Garbage collection happens automatically if you cons more than\n\
-gc-cons-threshold  bytes of Lisp data since previous garbage collection.")
+gc-cons-threshold  bytes of Lisp data since previous garbage collection;\n\
+those collections are usually minor ones (see gc-minor-collections).\n\
+Calling this function always does a major collection.")
   ()
 {
-  struct string_block *old_string_block;
+  garbage_collect_1 (0);
+  return Fcons (Fcons (make_number (total_conses),
+		       make_number (total_free_conses)),
+		Fcons (Fcons (make_number (total_symbols),
+			      make_number (total_free_symbols)),
+		       Fcons (Fcons (make_number (total_markers),
+				     make_number (total_free_markers)),
+			      Fcons (make_number (total_string_size),
+				     Fcons (make_number (total_vector_size),
+					    Fcons (gc_pause_vector (0),
+						   Fcons (gc_pause_vector (1),
+							  Qnil)))))));
+}
 
-  register struct gcpro *tail;
-  register struct specbinding *bind;
-  struct catchtag *catch;
-  struct handler *handler;
-  register struct backtrace *backlist;
+/* Collect garbage because consing_since_gc has passed gc_trigger.
+ Do a minor collection unless it is time for a major one.  */
+
+collect_garbage ()
+{
+  garbage_collect_1 (minors_since_major < gc_minors_per_major);
+}
+
+/* Collect garbage because Emacs is waiting for input,
+ if enough has been consed that a collection will be due soon.
+ Since no one is waiting for it, make it a major collection
+ unless there has been no minor one since the last major one.  */
+
+idle_collect_garbage ()
+{
+  if (gc_idle_percentage <= 0
+      || consing_since_gc < (double) gc_trigger * gc_idle_percentage / 100)
+    return;
+  garbage_collect_1 (minors_since_major == 0);
+}
+
+/* Pause-time limit on the trigger; zero if there is none.  */
+static int gc_pause_limit;
+
+/* Set gc_trigger after a collection that took `usecs' microseconds,
+ after `consed' bytes of consing.
+
+ The trigger is at least gc_cons_threshold, and at least
+ gc_cons_percentage percent of the live heap, so that a big heap
+ is not traced over and over to recover a little.
+
+ But if gc_pause_target is set, the trigger is at most gc_pause_limit.
+ The time a minor collection takes grows with the consing before it,
+ so one that was too slow cuts the limit in proportion;
+ one that took less than half the target doubles it, until
+ it no longer matters.  A major collection must trace the whole heap
+ however much was consed, so it does not change the limit.  */
+
+static void
+set_gc_trigger (minor, consed, usecs)
+     int minor, consed;
+     long usecs;
+{
+  register int trigger;
+  long target = (long) gc_pause_target * 1000;
+
+  gc_live_bytes = total_conses * sizeof (struct Lisp_Cons)
+		  + total_symbols * sizeof (struct Lisp_Symbol)
+		  + total_markers * sizeof (struct Lisp_Marker)
+		  + total_string_size
+		  + total_vector_size * sizeof (Lisp_Object);
+
+  trigger = gc_cons_threshold;
+  if (gc_cons_percentage > 0
+      && (double) gc_live_bytes * gc_cons_percentage / 100 > trigger)
+    trigger = (double) gc_live_bytes * gc_cons_percentage / 100;
+
+  if (target <= 0)
+    gc_pause_limit = 0;
+  else if (minor && usecs > target)
+    gc_pause_limit = (double) consed * target / usecs;
+  else if (minor && usecs < target / 2 && gc_pause_limit)
+    gc_pause_limit = gc_pause_limit < trigger ? 2 * gc_pause_limit : 0;
+
+  if (gc_pause_limit && trigger > gc_pause_limit)
+    trigger = gc_pause_limit;
+  if (trigger < 10000)
+    trigger = 10000;
+  gc_trigger = trigger;
+}
+
+static Lisp_Object
+gc_pause_vector (major)
+     int major;
+{
+  Lisp_Object val;
+  register int i;
+
+  val = Fmake_vector (make_number (GC_PAUSE_BUCKETS), Qnil);
+  for (i = 0; i < GC_PAUSE_BUCKETS; i++)
+    XFASTINT (XVECTOR (val)->contents[i]) = gc_pauses[major][i];
+  return val;
+}
+
+garbage_collect_1 (minor)
+     int minor;
+{
+  register struct cons_block *cblk;
   register Lisp_Object tem;
   char *omessage = minibuf_message;
-
+  int consed = consing_since_gc;
+  long start, mark_start, pause;
   register int i;
+  extern long get_real_usecs ();
 
-  if (!noninteractive)
+  start = get_real_usecs ();
+  if (!minor && !noninteractive)
     message1 ("Garbage collecting...");
 
   /* Don't keep command history around forever */
@@ -712,120 +1279,378 @@ gc-cons-threshold  bytes of Lisp data since previous garbage collection.")
     XCONS (tem)->cdr = Qnil;
 
   gc_in_progress = 1;
+  gc_minor = minor;
+  weak_hash_tables = Qnil;
+  /* Objects in the call caches may be freed or moved */
+  function_generation++;
 
-  clear_marks ();
-  old_string_block = current_string_block;
-  current_string_block = 0;
-  total_string_size = 0;
-  init_strings ();
-
-  for (tail = gcprolist; tail; tail = tail->next)
+  if (!minor)
     {
-      for (i = 0; i < tail->nvars; i++)
-	{
-	  tem = tail->var[i];
-	  tail->var[i] = mark_object (tem);
-	}
+      clear_marks ();
+      total_string_size = 0;
     }
-  for (i = 0; i < staticidx; i++)
+
+  mark_start = get_real_usecs ();
+  gc_mark_max_depth = 0;
+  gc_mark_overflows = 0;
+  mark_roots ();
+  if (minor)
+    mark_old_generation ();
+  while (mark_stack_overflowed)
+    rescan_marked_objects ();
+  gc_mark_usecs = get_real_usecs () - mark_start;
+
+  if (minor)
     {
-      tem = *staticvec[i];
-      *staticvec[i] = mark_object (tem);
+      gc_sweep_young ();
+      minors_since_major++;
     }
-  for (bind = specpdl; bind != specpdl_ptr; bind++)
+  else
     {
-      bind->symbol = mark_object (bind->symbol);
-      bind->old_value = mark_object (bind->old_value);
+      prune_always_remembered ();
+      gc_sweep ();
+      clear_marks ();
+      minors_since_major = 0;
     }
-  for (catch = catchlist; catch; catch = catch->next)
-    {
-      catch->tag = mark_object (catch->tag);
-      catch->val = mark_object (catch->val);
-    }  
-  for (handler = handlerlist; handler; handler = handler->next)
+
+  /* Everything that survived is old now;
+     sweep_strings has already done this for the strings.  */
+  for (cblk = cons_block; cblk; cblk = cblk->next)
     {
-      handler->handler = mark_object (handler->handler);
-      handler->var = mark_object (handler->var);
-    }  
-  for (backlist = backtrace_list; backlist; backlist = backlist->next)
+      if (cblk->young_from != CONS_BLOCK_SIZE)
+	cblk->young_from = cblk == cons_block ? cons_block_index : CONS_BLOCK_SIZE;
+      cblk->dirty = 0;
+    }
+  for (cblk = recycled_blocks; cblk; cblk = cblk->next_recycled)
     {
-      tem = *backlist->function;
-      *backlist->function = mark_object (tem);
-      if (backlist->nargs == UNEVALLED || backlist->nargs == MANY)
-	{
-	  tem = *backlist->args;
-	  *backlist->args = mark_object (tem);
-	}
-      else
-	for (i = 0; i < backlist->nargs; i++)
-	  {
-	    tem = backlist->args[i];
-	    backlist->args[i] = mark_object (tem);
-	  }
-    }  
-
-  gc_sweep (old_string_block);
+      bzero (cblk->recycled, sizeof cblk->recycled);
+      cblk->any_recycled = 0;
+    }
+  recycled_blocks = 0;
+  remembered_count = 0;
+  remembered_overflow = 0;
+  old_vectors = all_vectors;
 
-  clear_marks ();
   gc_in_progress = 0;
+  gc_minor = 0;
 
   consing_since_gc = 0;
   if (gc_cons_threshold < 10000)
     gc_cons_threshold = 10000;
 
+  pause = get_real_usecs () - start;
+  set_gc_trigger (minor, consed, pause);
+  pause /= 1000;
+  for (i = 0; i < GC_PAUSE_BUCKETS - 1 && pause >= (1 << i); i++);
+  gc_pauses[!minor][i]++;
+
+  if (minor)
+    return;
   if (omessage)
     message1 (omessage);
   else if (!noninteractive)
     message1 ("Garbage collecting...done");
-  
-  return Fcons (Fcons (make_number (total_conses),
-		       make_number (total_free_conses)),
-		Fcons (Fcons (make_number (total_symbols),
-			      make_number (total_free_symbols)),
-		       Fcons (Fcons (make_number (total_markers),
-				     make_number (total_free_markers)),
-			      Fcons (make_number (total_string_size),
-				     Fcons (make_number (total_vector_size),
-					    Qnil)))));
 }
 
-static void
-clear_marks ()
+/* Nonzero if obj is a cons or string made since the last garbage collection.  */
+
+static int
+young_object_p (obj)
+     Lisp_Object obj;
 {
-  /* Clear marks on all strings */
-  {
-    register struct string_block *csb;
-    register int pos;
+  if (PURE_P (obj))
+    return 0;
+#ifdef SWITCH_ENUM_BUG
+  switch ((int) XTYPE (obj))
+#else
+  switch (XTYPE (obj))
+#endif
+    {
+    case Lisp_Cons:
+    case Lisp_Buffer_Local_Value:
+    case Lisp_Some_Buffer_Local_Value:
+      return YOUNG_CONS_P (XCONS (obj));
 
-    for (csb = current_string_block; csb; csb = csb->next)
-      {
-	pos = 0;
-	while (pos < csb->pos)
-	  {
-	    register struct Lisp_String *nextstr
-	      = (struct Lisp_String *) &csb->chars[pos];
-	    register int fullsize;
-
-	    nextstr->size &= ~dont_copy_flag;
-	    fullsize = nextstr->size + sizeof (int);	
-	    
-	    fullsize += sizeof (int);
-	    fullsize &= ~(sizeof (int) - 1);
-	    pos += fullsize;
-	  }
-      }
-  }
-  /* Clear marks on all conses */
-  {
-    register struct cons_block *cblk;
-    register int lim = cons_block_index;
-  
-    for (cblk = cons_block; cblk; cblk = cblk->next)
-      {
-	register int i;
-	for (i = 0; i < lim; i++)
-	  XUNMARK (cblk->conses[i].car);
-	lim = CONS_BLOCK_SIZE;
+    case Lisp_String:
+      return (*string_flags (XSTRING (obj)) & STRING_YOUNG) != 0;
+    }
+  return 0;
+}
+
+/* Call this after storing `val' into a slot of the symbol or vector `obj'.
+   A minor collection looks for pointers to young objects only in the
+   symbols and vectors recorded this way, and a few others.  */
+
+remember_store (obj, val)
+     Lisp_Object obj, val;
+{
+  if (young_object_p (val))
+    remember_object (obj);
+}
+
+/* Record the symbol or vector `obj' for the next minor collection
+   to scan, whatever was stored into it.  */
+
+remember_object (obj)
+     Lisp_Object obj;
+{
+  register Lisp_Object *new;
+
+  if (remembered_count > 0 && EQ (remembered[remembered_count - 1], obj))
+    return;
+  if (remembered_count == remembered_size)
+    {
+      if (remembered_overflow)
+	return;
+      new = (Lisp_Object *) (remembered
+			     ? realloc (remembered, 2 * remembered_size * sizeof (Lisp_Object))
+			     : malloc (1000 * sizeof (Lisp_Object)));
+      if (!new)
+	{
+	  remembered_overflow = 1;
+	  return;
+	}
+      remembered_size = remembered ? 2 * remembered_size : 1000;
+      remembered = new;
+    }
+  remembered[remembered_count++] = obj;
+}
+
+/* Have every minor collection scan the window or process `obj'.  */
+
+remember_always (obj)
+     Lisp_Object obj;
+{
+  if (always_remembered_count == always_remembered_size)
+    {
+      always_remembered_size = always_remembered_size ? 2 * always_remembered_size : 50;
+      always_remembered
+	= (Lisp_Object *) (always_remembered
+			   ? xrealloc (always_remembered,
+				       always_remembered_size * sizeof (Lisp_Object))
+			   : xmalloc (always_remembered_size * sizeof (Lisp_Object)));
+    }
+  always_remembered[always_remembered_count++] = obj;
+}
+
+/* Have every minor collection scan the C variable at `address',
+   which DefLispVar is making a Lisp variable.  */
+
+remember_forwarded (address)
+     Lisp_Object *address;
+{
+  if (forwarded_vars_count == forwarded_vars_size)
+    {
+      forwarded_vars_size = forwarded_vars_size ? 2 * forwarded_vars_size : 100;
+      forwarded_vars
+	= (Lisp_Object **) (forwarded_vars
+			    ? xrealloc (forwarded_vars,
+					forwarded_vars_size * sizeof (Lisp_Object *))
+			    : xmalloc (forwarded_vars_size * sizeof (Lisp_Object *)));
+    }
+  forwarded_vars[forwarded_vars_count++] = address;
+}
+
+/* Forget the windows and processes that garbage collection
+   did not mark, since they are about to be freed.  */
+
+static void
+prune_always_remembered ()
+{
+  register int i, j;
+
+  for (i = j = 0; i < always_remembered_count; i++)
+    if (XVECTOR (always_remembered[i])->size & most_negative_fixnum)
+      always_remembered[j++] = always_remembered[i];
+  always_remembered_count = j;
+}
+
+/* Mark everything that the C code refers to directly.  */
+
+static void
+mark_roots ()
+{
+  register struct gcpro *tail;
+  register struct specbinding *bind;
+  struct catchtag *catch;
+  struct handler *handler;
+  register struct backtrace *backlist;
+  register Lisp_Object tem;
+  register int i;
+
+  for (tail = gcprolist; tail; tail = tail->next)
+    {
+      for (i = 0; i < tail->nvars; i++)
+	{
+	  tem = tail->var[i];
+	  tail->var[i] = mark_object (tem);
+	}
+    }
+  for (i = 0; i < staticidx; i++)
+    {
+      tem = *staticvec[i];
+      *staticvec[i] = mark_object (tem);
+    }
+  for (bind = specpdl; bind != specpdl_ptr; bind++)
+    {
+      bind->symbol = mark_object (bind->symbol);
+      bind->old_value = mark_object (bind->old_value);
+    }
+  for (catch = catchlist; catch; catch = catch->next)
+    {
+      catch->tag = mark_object (catch->tag);
+      catch->val = mark_object (catch->val);
+    }  
+  for (handler = handlerlist; handler; handler = handler->next)
+    {
+      handler->handler = mark_object (handler->handler);
+      handler->var = mark_object (handler->var);
+    }  
+  for (backlist = backtrace_list; backlist; backlist = backlist->next)
+    {
+      tem = *backlist->function;
+      *backlist->function = mark_object (tem);
+      if (backlist->nargs == UNEVALLED || backlist->nargs == MANY)
+	{
+	  tem = *backlist->args;
+	  *backlist->args = mark_object (tem);
+	}
+      else
+	for (i = 0; i < backlist->nargs; i++)
+	  {
+	    tem = backlist->args[i];
+	    backlist->args[i] = mark_object (tem);
+	  }
+    }  
+  mark_lisp_profile (mark_object);
+}
+
+/* For a minor collection, mark the young objects that old objects
+ point to.  The old objects that can point to them are the symbols
+ and vectors recorded by remember_store, the vectors made since the
+ last collection, the windows and processes, the C variables of
+ DefLispVar, the buffers, and the old conses in dirty blocks.  */
+
+static void
+mark_old_generation ()
+{
+  register int i, lim;
+  register struct Lisp_Vector *v;
+
+  if (remembered_overflow)
+    {
+      /* We lost track; look at all symbols, and below, all vectors.  */
+      register struct symbol_block *sblk;
+      Lisp_Object tem;
+
+      lim = symbol_block_index;
+      for (sblk = symbol_block; sblk; sblk = sblk->next)
+	{
+	  for (i = 0; i < lim; i++)
+	    if (sblk->symbols[i].name)	/* Else on the free list */
+	      {
+		XSET (tem, Lisp_Symbol, &sblk->symbols[i]);
+		mark_old_object (tem);
+	      }
+	  lim = SYMBOL_BLOCK_SIZE;
+	}
+      /* This is reset when the collection is done.  */
+      old_vectors = 0;
+    }
+  else
+    {
+      for (i = 0; i < remembered_count; i++)
+	mark_old_object (remembered[i]);
+      for (i = 0; i < always_remembered_count; i++)
+	mark_old_object (always_remembered[i]);
+    }
+
+  for (i = 0; i < forwarded_vars_count; i++)
+    *forwarded_vars[i] = mark_object (*forwarded_vars[i]);
+
+  /* Vectors made since the last collection */
+  for (v = all_vectors; v != old_vectors; v = v->next)
+    for (i = 0; i < v->size; i++)
+      v->contents[i] = mark_object (v->contents[i]);
+
+#ifndef standalone
+  /* Buffers.  There are few, and their slots are set all over.  */
+  {
+    register struct buffer *b;
+    Lisp_Object tem;
+
+    for (b = all_buffers; b; b = b->next)
+      {
+	XSET (tem, Lisp_Buffer, b);
+	mark_buffer (tem);
+	XUNMARK (b->name);
+      }
+  }
+#endif /* standalone */
+
+  /* Old conses that have been changed */
+  {
+    register struct cons_block *cblk;
+    register struct Lisp_Cons *ptr;
+
+    lim = cons_block_index;
+    for (cblk = cons_block; cblk; cblk = cblk->next)
+      {
+	if (cblk->dirty)
+	  for (i = 0; i < lim && i < cblk->young_from; i++)
+	    {
+	      ptr = &cblk->conses[i];
+	      if (FREE_CONS_P (ptr) || RECYCLED_CONS_P (ptr))
+		continue;
+	      ptr->car = mark_object (ptr->car);
+	      ptr->cdr = mark_object (ptr->cdr);
+	    }
+	lim = CONS_BLOCK_SIZE;
+      }
+  }
+}
+
+/* Mark the young objects that the old symbol or vector `obj' points to.  */
+
+static void
+mark_old_object (obj)
+     Lisp_Object obj;
+{
+  register struct Lisp_Symbol *ptr;
+  register struct Lisp_Vector *v;
+  register int i;
+  Lisp_Object tem;
+
+  if (XTYPE (obj) == Lisp_Symbol)
+    {
+      ptr = XSYMBOL (obj);
+      XSET (tem, Lisp_String, ptr->name);
+      tem = mark_object (tem);
+      ptr->name = XSTRING (tem);
+      ptr->value = mark_object (ptr->value);
+      ptr->function = mark_object (ptr->function);
+      ptr->plist = mark_object (ptr->plist);
+      return;
+    }
+  v = XVECTOR (obj);
+  for (i = 0; i < v->size; i++)
+    v->contents[i] = mark_object (v->contents[i]);
+}
+
+static void
+clear_marks ()
+{
+  /* Clear marks on all conses */
+  {
+    register struct cons_block *cblk;
+    register int lim = cons_block_index;
+  
+    for (cblk = cons_block; cblk; cblk = cblk->next)
+      {
+	register int i;
+	for (i = 0; i < lim; i++)
+	  XUNMARK (cblk->conses[i].car);
+	lim = CONS_BLOCK_SIZE;
       }
   }
   /* Clear marks on all symbols */
@@ -866,31 +1691,118 @@ clear_marks ()
   }
 }
 
-/* Mark one Lisp object, and recursively mark all the objects it points to
+static Lisp_Object mark_one ();
+
+static
+push_mark (slot, count)
+     Lisp_Object *slot;
+     int count;
+{
+  register struct mark_entry *new;
+  int newsize;
+
+  if (count <= 0)
+    return;
+  if (mark_stack_depth == mark_stack_size)
+    {
+      newsize = mark_stack_size ? 2 * mark_stack_size : 1024;
+      new = 0;
+      if (newsize <= MARK_STACK_MAX)
+	new = (struct mark_entry *) (mark_stack
+				     ? realloc (mark_stack, newsize * sizeof *new)
+				     : malloc (newsize * sizeof *new));
+      if (!new)
+	{
+	  mark_stack_overflowed = 1;
+	  gc_mark_overflows++;
+	  return;
+	}
+      mark_stack = new;
+      mark_stack_size = newsize;
+    }
+  mark_stack[mark_stack_depth].slot = slot;
+  mark_stack[mark_stack_depth].count = count;
+  if (++mark_stack_depth > gc_mark_max_depth)
+    gc_mark_max_depth = mark_stack_depth;
+}
+
+/* Mark the slots on the mark stack until it is empty.
+ A slot's mark bit (a cons's car, or a symbol's plist) is preserved.  */
+
+static
+drain_mark_stack ()
+{
+  register struct mark_entry *top;
+  register Lisp_Object *slot;
+  Lisp_Object tem;
+  int marked;
+
+  while (mark_stack_depth > 0)
+    {
+      top = &mark_stack[mark_stack_depth - 1];
+      slot = top->slot++;
+      if (--top->count == 0)
+	mark_stack_depth--;
+      if (mark_stack_depth > 0)
+	PREFETCH (XUINT (*mark_stack[mark_stack_depth - 1].slot));
+
+      tem = *slot;
+      marked = XMARKBIT (tem);
+      XUNMARK (tem);
+      tem = mark_one (tem);
+      if (marked)
+	XMARK (tem);
+      *slot = tem;
+    }
+}
+
+/* Mark one Lisp object, and all the objects it points to
  if this is the first time it is being marked.
- If the object is a string, it is copied (once, only) and the copy is returned.
- The original string's `size' is set to a value in which 1<<31 is set
-   and the rest of which is the string address shifted right by one.
- If the object is not a string, it is returned unchanged. */
+ Nothing is moved, so the value is always `obj' itself. */
 
 static Lisp_Object
 mark_object (obj)
      Lisp_Object obj;
 {
-  Lisp_Object original;
+  obj = mark_one (obj);
+  drain_mark_stack ();
+  return obj;
+}
 
-  original = obj;
+/* Mark obj itself and push the slots inside it on the mark stack.
+ Return value is as for mark_object.  */
 
- loop:
-#ifndef VIRT_ADDR_VARIES
+static Lisp_Object
+mark_one (obj)
+     Lisp_Object obj;
+{
   /* Need not trace pointers to pure storage */
-  if (XUINT (obj) < (unsigned int) edata && XUINT (obj) >= 0)
-    return original;
-#else /* VIRT_ADDR_VARIES */
-  if (XUINT (obj) < (unsigned int) ((char *) pure + PURESIZE)
-      && XUINT (obj) >= (unsigned int) pure)
-    return original;
-#endif /* VIRT_ADDR_VARIES */
+  if (PURE_P (obj))
+    return obj;
+
+  /* A minor collection traces only young conses and strings;
+     all other objects are old, and mark_old_generation scans them.  */
+  if (gc_minor)
+#ifdef SWITCH_ENUM_BUG
+    switch ((int) XGCTYPE (obj))
+#else
+    switch (XGCTYPE (obj))
+#endif
+      {
+      case Lisp_Cons:
+      case Lisp_Buffer_Local_Value:
+      case Lisp_Some_Buffer_Local_Value:
+	if (!YOUNG_CONS_P (XCONS (obj)))
+	  return obj;
+	/* drops through! */
+      case Lisp_String:
+      case Lisp_Temp_Vector:
+      case Lisp_Objfwd:
+	break;
+
+      default:
+	return obj;
+      }
 
 #ifdef SWITCH_ENUM_BUG
   switch ((int) XGCTYPE (obj))
@@ -900,80 +1812,64 @@ mark_object (obj)
     {
     case Lisp_String:
       {
-	register struct Lisp_String *ptr = XSTRING (obj);
-	Lisp_Object tem;
+	register unsigned char *flags = string_flags (XSTRING (obj));
 
-	if (ptr->size & most_negative_fixnum)
-	  {
-	    XSETSTRING (obj, (struct Lisp_String *) (ptr->size & ~most_negative_fixnum));
-	    return obj;
-	  }
-	if (ptr->size & dont_copy_flag)
+	if (*flags & STRING_MARKED)
+	  return obj;
+	if (gc_minor && !(*flags & STRING_YOUNG))
 	  return obj;
-	total_string_size += ptr->size;
-	tem = make_string (ptr->data, ptr->size);
-	ptr->size = most_negative_fixnum | XINT (tem);
-	XSTRING (tem)->size |= dont_copy_flag;
-	return tem;
+	*flags |= STRING_MARKED;
+	total_string_size += XSTRING (obj)->size;
+	return obj;
       }
 
     case Lisp_Vector:
     case Lisp_Window:
     case Lisp_Process:
+    case Lisp_Hash_Table:
       {
 	register struct Lisp_Vector *ptr = XVECTOR (obj);
 	register int size = ptr->size;
-	register int i;
-	Lisp_Object tem;
 
 	if (size & most_negative_fixnum) break;   /* Already marked */
 	ptr->size |= most_negative_fixnum; /* Else mark it */
-	for (i = 0; i < size; i++)     /* and then mark its elements */
+	if (XGCTYPE (obj) == Lisp_Hash_Table
+	    && !NULL (XHASH_TABLE (obj)->weak))
 	  {
-	    tem = ptr->contents[i];
-	    ptr->contents[i] = mark_object (tem);
+	    mark_weak_hash_table (obj);
+	    break;
 	  }
+	push_mark (ptr->contents, size);     /* and then its elements */
       }
       break;
 
     case Lisp_Temp_Vector:
       {
+	/* This lives on the C stack, so rescan_marked_objects
+	   could not find it again; mark its elements now.  */
 	register struct Lisp_Vector *ptr = XVECTOR (obj);
 	register int size = ptr->size;
 	register int i;
-	Lisp_Object tem;
 
-	for (i = 0; i < size; i++)     /* and then mark its elements */
-	  {
-	    tem = ptr->contents[i];
-	    ptr->contents[i] = mark_object (tem);
-	  }
+	for (i = 0; i < size; i++)
+	  ptr->contents[i] = mark_object (ptr->contents[i]);
       }
       break;
 
     case Lisp_Symbol:
       {
 	register struct Lisp_Symbol *ptr = XSYMBOL (obj);
-	struct Lisp_Symbol *ptrx;
 	Lisp_Object tem;
 
-	if (XMARKBIT (ptr->plist)) break;
-	XMARK (ptr->plist);
-	XSET (tem, Lisp_String, ptr->name);
-	tem = mark_object (tem);
-	ptr->name = XSTRING (tem);
-	ptr->value = mark_object (ptr->value);
-	ptr->function = mark_object (ptr->function);
-	tem = ptr->plist;
-	XUNMARK (tem);
-	ptr->plist = mark_object (tem);
-	XMARK (ptr->plist);
-	ptr = ptr->next;
-	if (ptr)
+	/* Mark this symbol and the rest of its obarray bucket.  */
+	for (; ptr && !XMARKBIT (ptr->plist); ptr = ptr->next)
 	  {
-	    ptrx = ptr;		/* Use pf ptrx avoids compiled bug on Sun */
-	    XSETSYMBOL (obj, ptrx);
-	    goto loop;
+	    XMARK (ptr->plist);
+	    XSET (tem, Lisp_String, ptr->name);
+	    tem = mark_one (tem);
+	    ptr->name = XSTRING (tem);
+	    /* value, function and plist */
+	    push_mark (&ptr->value, 3);
 	  }
       }
       break;
@@ -989,19 +1885,11 @@ mark_object (obj)
     case Lisp_Buffer_Local_Value:
     case Lisp_Some_Buffer_Local_Value:
       {
-	Lisp_Object tem;
 	register struct Lisp_Cons *ptr = XCONS (obj);
 	if (XMARKBIT (ptr->car)) break;
-	tem = ptr->car;
 	XMARK (ptr->car);
-	ptr->car = mark_object (tem);
-	XMARK (ptr->car);
-	if (XGCTYPE (ptr->cdr) != Lisp_String)
-	  {
-	    obj = ptr->cdr;
-	    goto loop;
-	  }
-	ptr->cdr = mark_object (ptr->cdr);
+	/* car and cdr */
+	push_mark (&ptr->car, 2);
       }
       break;
     
@@ -1017,7 +1905,219 @@ mark_object (obj)
     /* Don't bother with Lisp_Buffer_Objfwd,
        since all markable slots in current buffer marked anyway.  */
     }
-  return original;
+  return obj;
+}
+
+/* After the mark stack has overflowed, push the slots of every marked
+ object again, so that those whose runs were dropped get marked.
+ Marking is idempotent, so doing this to the others does no harm.  */
+
+static void
+rescan_marked_objects ()
+{
+  register int i, lim;
+  Lisp_Object tem;
+
+  mark_stack_overflowed = 0;
+
+  /* Conses.  In a minor collection, only young ones are marked.  */
+  {
+    register struct cons_block *cblk;
+
+    lim = cons_block_index;
+    for (cblk = cons_block; cblk; cblk = cblk->next)
+      {
+	for (i = 0; i < lim; i++)
+	  if (XMARKBIT (cblk->conses[i].car))
+	    {
+	      push_mark (&cblk->conses[i].car, 2);
+	      drain_mark_stack ();
+	    }
+	lim = CONS_BLOCK_SIZE;
+      }
+  }
+
+  /* In a minor collection, nothing else is marked,
+     and mark_old_generation has scanned everything else.  */
+  if (gc_minor)
+    return;
+
+  /* Symbols */
+  {
+    register struct symbol_block *sblk;
+
+    lim = symbol_block_index;
+    for (sblk = symbol_block; sblk; sblk = sblk->next)
+      {
+	for (i = 0; i < lim; i++)
+	  if (XMARKBIT (sblk->symbols[i].plist))
+	    {
+	      push_mark (&sblk->symbols[i].value, 3);
+	      drain_mark_stack ();
+	    }
+	lim = SYMBOL_BLOCK_SIZE;
+      }
+  }
+
+  /* Vectors.  Weak hash tables and their bucket vectors
+     must not have all their slots marked; just mark their values.  */
+  {
+    register struct Lisp_Vector *v;
+
+    for (v = all_vectors; v; v = v->next)
+      if (v->size & most_negative_fixnum)
+	{
+	  for (tem = weak_hash_tables; !NULL (tem);
+	       tem = XHASH_TABLE (tem)->next_weak)
+	    if (v == XVECTOR (tem) || v == XVECTOR (XHASH_TABLE (tem)->buckets))
+	      break;
+	  if (!NULL (tem))
+	    mark_weak_values (XHASH_TABLE (tem));
+	  else
+	    {
+	      push_mark (v->contents, v->size & ~most_negative_fixnum);
+	      drain_mark_stack ();
+	    }
+	}
+  }
+
+#ifndef standalone
+  /* Buffers */
+  {
+    register struct buffer *b;
+
+    for (b = all_buffers; b; b = b->next)
+      if (XMARKBIT (b->name))
+	{
+	  XSET (tem, Lisp_Buffer, b);
+	  mark_buffer (tem);
+	}
+  }
+#endif /* standalone */
+}
+
+/* Mark a weak hash table: its bucket vector and the values in it,
+   but not the keys, nor the conses that hold them.
+   sweep_weak_hash_tables will later keep those entries
+   whose keys were marked some other way.  */
+
+mark_weak_hash_table (table)
+     Lisp_Object table;
+{
+  register struct Lisp_Hash_Table *h = XHASH_TABLE (table);
+  Lisp_Object tem;
+
+  XVECTOR (h->buckets)->size |= most_negative_fixnum;
+  mark_weak_values (h);
+
+  /* Put the table on the list, unless rescan_marked_objects
+     has found it again.  */
+  for (tem = weak_hash_tables; !NULL (tem); tem = XHASH_TABLE (tem)->next_weak)
+    if (XHASH_TABLE (tem) == h)
+      return;
+  h->next_weak = weak_hash_tables;
+  weak_hash_tables = table;
+}
+
+/* Mark the values in weak hash table `h'.  */
+
+mark_weak_values (h)
+     register struct Lisp_Hash_Table *h;
+{
+  register struct Lisp_Vector *buckets = XVECTOR (h->buckets);
+  register int size = buckets->size & ~most_negative_fixnum;
+  register int i;
+  Lisp_Object tail;
+  register struct Lisp_Cons *entry;
+
+  for (i = 0; i < size; i++)
+    for (tail = buckets->contents[i]; LISTP (tail); tail = XCONS (tail)->cdr)
+      {
+	entry = XCONS (XCONS (tail)->car);
+	entry->cdr = mark_object (entry->cdr);
+      }
+}
+
+/* Return nonzero if *objptr has been marked, or need not be.  */
+
+static int
+survives_gc (objptr)
+     Lisp_Object *objptr;
+{
+  Lisp_Object obj;
+
+  obj = *objptr;
+  if (PURE_P (obj))
+    return 1;
+
+  switch (XGCTYPE (obj))
+    {
+    case Lisp_String:
+      return (*string_flags (XSTRING (obj)) & STRING_MARKED) != 0;
+
+    case Lisp_Vector:
+    case Lisp_Window:
+    case Lisp_Process:
+    case Lisp_Hash_Table:
+      return (XVECTOR (obj)->size & most_negative_fixnum) != 0;
+
+    case Lisp_Cons:
+      return XMARKBIT (XCONS (obj)->car);
+
+    case Lisp_Symbol:
+      return XMARKBIT (XSYMBOL (obj)->plist);
+
+    case Lisp_Marker:
+      return XMARKBIT (XMARKER (obj)->chain);
+
+    case Lisp_Buffer:
+      return XMARKBIT (XBUFFER (obj)->name);
+    }
+  return 1;
+}
+
+/* Remove from each weak hash table the entries whose keys were not marked,
+   and mark the conses of the rest.  */
+
+static
+sweep_weak_hash_tables ()
+{
+  register struct Lisp_Hash_Table *h;
+  register struct Lisp_Vector *buckets;
+  register struct Lisp_Cons *cell, *prev;
+  Lisp_Object table, tail, next;
+  register int i, size, count;
+
+  for (table = weak_hash_tables; !NULL (table); table = next)
+    {
+      h = XHASH_TABLE (table);
+      next = h->next_weak;
+      h->next_weak = Qnil;
+      buckets = XVECTOR (h->buckets);
+      size = buckets->size & ~most_negative_fixnum;
+      count = 0;
+      for (i = 0; i < size; i++)
+	{
+	  prev = 0;
+	  for (tail = buckets->contents[i]; LISTP (tail); tail = cell->cdr)
+	    {
+	      cell = XCONS (tail);
+	      if (survives_gc (&XCONS (cell->car)->car))
+		{
+		  XMARK (XCONS (cell->car)->car);
+		  XMARK (cell->car);
+		  prev = cell;
+		  count++;
+		}
+	      else if (prev)
+		prev->cdr = cell->cdr;
+	      else
+		buckets->contents[i] = cell->cdr;
+	    }
+	}
+      XFASTINT (h->count) = count;
+    }
+  weak_hash_tables = Qnil;
 }
 
 /* Mark the pointers in a buffer structure.  */
@@ -1053,6 +2153,7 @@ mark_buffer (buf)
   buffer->left_margin = mark_object (buffer->left_margin);
   buffer->auto_fill_hook = mark_object (buffer->auto_fill_hook);
   buffer->local_var_alist = mark_object (buffer->local_var_alist);
+  buffer->local_var_slots = mark_object (buffer->local_var_slots);
   buffer->truncate_lines = mark_object (buffer->truncate_lines);
   buffer->ctl_arrow = mark_object (buffer->ctl_arrow);
   buffer->selective_display = mark_object (buffer->selective_display);
@@ -1065,9 +2166,11 @@ mark_buffer (buf)
 /* Find all structures not marked, and free them. */
 
 static void
-gc_sweep (old_string_block)
-     struct string_block *old_string_block;
+gc_sweep ()
 {
+  /* This must come first, while the marks it looks at are intact.  */
+  sweep_weak_hash_tables ();
+
   /* Put all unmarked conses on free list */
   {
     register struct cons_block *cblk;
@@ -1083,6 +2186,7 @@ gc_sweep (old_string_block)
 	  if (!XMARKBIT (cblk->conses[i].car))
 	    {
 	      XSETCONS (cblk->conses[i].car, cons_free_list);
+	      SET_FREE_CONS (&cblk->conses[i]);
 	      num_free++;
 	      cons_free_list = &cblk->conses[i];
 	    }
@@ -1108,6 +2212,7 @@ gc_sweep (old_string_block)
 	  if (!XMARKBIT (sblk->symbols[i].plist))
 	    {
 	      XSETSYMBOL (sblk->symbols[i].value, symbol_free_list);
+	      sblk->symbols[i].name = 0;
 	      symbol_free_list = &sblk->symbols[i];
 	      num_free++;
 	    }
@@ -1199,18 +2304,281 @@ gc_sweep (old_string_block)
 	}
   }
 
-  /* Free all old string blocks, since all strings still used have been copied. */
-  {
-    register struct string_block *sblk = old_string_block;
-    while (sblk)
+  /* Put all unmarked strings on the free lists */
+  sweep_strings (0);
+}
+
+/* Free the young conses that a minor collection did not mark.
+ The old conses, and the conses already on the free list, are left alone.
+ The young conses are at the ends of the newest blocks,
+ and scattered through the blocks on the recycled_blocks chain.  */
+
+static void
+gc_sweep_young ()
+{
+  register struct cons_block *cblk;
+  register struct Lisp_Cons *ptr;
+  register int i, lim = cons_block_index;
+  register int num_free = 0, num_used = 0;
+
+  for (cblk = cons_block; cblk; cblk = cblk->next)
+    {
+      if (cblk->young_from == CONS_BLOCK_SIZE)
+	break;
+      for (i = cblk->young_from; i < lim; i++)
+	{
+	  ptr = &cblk->conses[i];
+	  if (XMARKBIT (ptr->car))
+	    {
+	      XUNMARK (ptr->car);
+	      num_used++;
+	    }
+	  else if (!FREE_CONS_P (ptr))
+	    {
+	      XSETCONS (ptr->car, cons_free_list);
+	      SET_FREE_CONS (ptr);
+	      cons_free_list = ptr;
+	      num_free++;
+	    }
+	}
+      /* The blocks made since the last collection come first,
+	 and only the oldest of them can have old conses too.  */
+      if (cblk->young_from != 0)
+	break;
+      lim = CONS_BLOCK_SIZE;
+    }
+
+  for (cblk = recycled_blocks; cblk; cblk = cblk->next_recycled)
+    for (i = 0; i < cblk->young_from; i++)
       {
-	struct string_block *next = sblk->next;
-	free (sblk);
-	sblk = next;
+	ptr = &cblk->conses[i];
+	if (!RECYCLED_CONS_P (ptr))
+	  continue;
+	if (XMARKBIT (ptr->car))
+	  {
+	    XUNMARK (ptr->car);
+	    num_used++;
+	  }
+	else if (!FREE_CONS_P (ptr))
+	  {
+	    XSETCONS (ptr->car, cons_free_list);
+	    SET_FREE_CONS (ptr);
+	    cons_free_list = ptr;
+	    num_free++;
+	  }
       }
-  }
+  total_conses += num_used;
+  total_free_conses += num_free;
+
+  sweep_strings (1);
 }
-
+
+/* Put the unmarked strings in slabs on the free lists,
+ free the unmarked large strings, and make the rest old and unmarked.
+ If `minor' is nonzero, look only at the young strings;
+ the old ones were not marked and must all be kept.  */
+
+static void
+sweep_strings (minor)
+     int minor;
+{
+  register struct string_slab *slab;
+  register struct large_string_head *large, *next;
+  register struct Lisp_String *s;
+  register int i, flags;
+
+  for (slab = string_slabs; slab; slab = slab->next)
+    {
+      if (minor && slab->young == 0)
+	continue;
+      for (i = 0; i < slab->nslots; i++)
+	{
+	  flags = slab->flags[i];
+	  if (!(flags & STRING_IN_USE)
+	      || flags & STRING_MARKED
+	      || (minor && !(flags & STRING_YOUNG)))
+	    {
+	      slab->flags[i] = flags & STRING_IN_USE;
+	      continue;
+	    }
+	  s = (struct Lisp_String *) (slab->slots + i * slab->slot_size);
+	  s->size = (LISP_WORD) string_free_list[slab->class];
+	  string_free_list[slab->class] = s;
+	  slab->flags[i] = 0;
+	}
+      slab->young = 0;
+    }
+
+  /* Pass 0 does the old large strings; pass 1, the young ones.  */
+  for (i = minor; i < 2; i++)
+    {
+      if (i == 0)
+	large = large_strings, large_strings = 0;
+      else
+	large = young_large_strings, young_large_strings = 0;
+      for (; large; large = next)
+	{
+	  next = large->next;
+	  if (large->flags & STRING_MARKED)
+	    {
+	      large->flags = STRING_IN_USE;
+	      large->next = large_strings;
+	      large_strings = large;
+	    }
+	  else
+	    free (large);
+	}
+    }
+}
+
+/* The allocation profiler.
+
+ While it runs, it samples about one allocation in every
+ alloc_sample_interval bytes, and charges it to the function that is
+ innermost in backtrace_list.  alloc_profile is a hash table that maps
+ each function so charged to a vector that holds, for each type of
+ object, an estimate of how many objects and how many bytes of that
+ type the function has allocated.  */
+
+static int alloc_profiling;
+static int alloc_sample_interval;
+static Lisp_Object alloc_profile;
+
+static char *alloc_type_names[ALLOC_TYPES] =
+  { "cons", "vector", "string", "symbol", "marker" };
+
+/* Add n to the fixnum in `slot', stopping at the largest fixnum
+   so that a big count cannot spill into the type bits.  */
+
+static void
+add_to_count (slot, n)
+     Lisp_Object *slot;
+     int n;
+{
+  if (XFASTINT (*slot) > MOST_POSITIVE_FIXNUM - n)
+    XFASTINT (*slot) = MOST_POSITIVE_FIXNUM;
+  else
+    XFASTINT (*slot) += n;
+}
+
+static void
+sample_allocation (type, nbytes)
+     int type, nbytes;
+{
+  register struct Lisp_Vector *counts;
+  Lisp_Object fun, tem;
+  int bytes;
+
+  /* Don't sample the allocation done here.  */
+  alloc_sample_countdown = ALLOC_SAMPLE_NEVER;
+  if (!alloc_profiling)
+    return;
+
+  /* The sample stands for alloc_sample_interval bytes of objects
+     of this size, or for just this object if it is bigger.  */
+  bytes = nbytes > alloc_sample_interval ? nbytes : alloc_sample_interval;
+
+  fun = backtrace_list ? *backtrace_list->function : Qnil;
+  tem = Fgethash (fun, alloc_profile, Qnil);
+  if (NULL (tem))
+    {
+      tem = Fmake_vector (make_number (2 * ALLOC_TYPES), make_number (0));
+      Fputhash (fun, tem, alloc_profile);
+    }
+  counts = XVECTOR (tem);
+  add_to_count (&counts->contents[2 * type], bytes / nbytes);
+  add_to_count (&counts->contents[2 * type + 1], bytes);
+
+  alloc_sample_countdown = alloc_sample_interval;
+}
+
+DEFUN ("alloc-profile-start", Falloc_profile_start, Salloc_profile_start, 0, 1, 0,
+  "Start the allocation profiler, discarding the data it had collected.\n\
+It samples about one allocation in every INTERVAL bytes (default 4096),\n\
+and charges it to the innermost Lisp function being called.\n\
+An INTERVAL of 1 counts every allocation exactly.\n\
+alloc-profile-stop stops it; alloc-profile-data returns what it found.")
+  (interval)
+     Lisp_Object interval;
+{
+  extern Lisp_Object Fclrhash ();
+
+  if (NULL (interval))
+    XFASTINT (interval) = 4096;
+  CHECK_NUMBER (interval, 0);
+  if (XINT (interval) <= 0)
+    error ("Allocation profiler interval must be positive");
+
+  if (NULL (alloc_profile))
+    alloc_profile = Fmake_hash_table (Qnil, Qnil, Qnil);
+  else
+    Fclrhash (alloc_profile);
+  alloc_sample_interval = XINT (interval);
+  alloc_sample_countdown = alloc_sample_interval;
+  alloc_profiling = 1;
+  return Qnil;
+}
+
+DEFUN ("alloc-profile-stop", Falloc_profile_stop, Salloc_profile_stop, 0, 0, 0,
+  "Stop the allocation profiler.  Its data remain for alloc-profile-data.")
+  ()
+{
+  alloc_profiling = 0;
+  alloc_sample_countdown = ALLOC_SAMPLE_NEVER;
+  return Qnil;
+}
+
+DEFUN ("alloc-profile-data", Falloc_profile_data, Salloc_profile_data, 0, 0, 0,
+  "Return what the allocation profiler has found since it was started.\n\
+The value has an element (FUNCTION BYTES (TYPE OBJECTS . BYTES)...)\n\
+for each function that was found allocating.  FUNCTION is nil for\n\
+allocation outside of any Lisp function.  The first BYTES is the total;\n\
+after that comes an element for each TYPE of object it allocated:\n\
+cons, vector, string, symbol or marker.\n\
+Unless the profiler's interval was 1, all the numbers are estimates.")
+  ()
+{
+  register struct Lisp_Vector *buckets, *counts;
+  register int i, type, total;
+  Lisp_Object val, tail, types;
+  int was_profiling = alloc_profiling;
+
+  val = Qnil;
+  if (NULL (alloc_profile))
+    return val;
+
+  /* Don't profile ourselves.  */
+  Falloc_profile_stop ();
+
+  buckets = XVECTOR (XHASH_TABLE (alloc_profile)->buckets);
+  for (i = 0; i < buckets->size; i++)
+    for (tail = buckets->contents[i]; LISTP (tail); tail = XCONS (tail)->cdr)
+      {
+	counts = XVECTOR (XCONS (XCONS (tail)->car)->cdr);
+	types = Qnil;
+	total = 0;
+	for (type = ALLOC_TYPES - 1; type >= 0; type--)
+	  if (XFASTINT (counts->contents[2 * type]))
+	    {
+	      types = Fcons (Fcons (intern (alloc_type_names[type]),
+				    Fcons (counts->contents[2 * type],
+					   counts->contents[2 * type + 1])),
+			     types);
+	      total += XFASTINT (counts->contents[2 * type + 1]);
+	    }
+	val = Fcons (Fcons (XCONS (XCONS (tail)->car)->car,
+			    Fcons (make_number (total), types)),
+		     val);
+      }
+
+  if (was_profiling)
+    {
+      alloc_profiling = 1;
+      alloc_sample_countdown = alloc_sample_interval;
+    }
+  return val;
+}
+
 /* Initialization */
 
 init_alloc_once ()
@@ -1220,11 +2588,26 @@ init_alloc_once ()
   for (i = 0, x = 1; (x <<= 1) & ~1; i++)
     /*empty loop*/;
   most_negative_fixnum = 1 << i;
-  dont_copy_flag = 1 << (i - 1);
 
   Vpurify_flag = Qt;
 
   pureptr = 0;
+#ifdef PURE_SEGMENTS
+  pure_base = (char *) mmap ((char *) PURE_ADDRESS, PURE_RESERVE, PROT_NONE,
+			     MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+  if (pure_base == (char *) -1)
+    abort ();
+  pure_size = 0;
+  pure_limit = pure_base;
+#else /* not PURE_SEGMENTS */
+  pure_base = (char *) pure;
+  pure_size = PURESIZE;
+#ifdef VIRT_ADDR_VARIES
+  pure_limit = pure_base + PURESIZE;
+#else /* not VIRT_ADDR_VARIES */
+  pure_limit = (char *) edata;
+#endif /* not VIRT_ADDR_VARIES */
+#endif /* not PURE_SEGMENTS */
   all_vectors = 0;
   init_strings ();
   init_cons ();
@@ -1233,7 +2616,13 @@ init_alloc_once ()
   gcprolist = 0;
   staticidx = 0;
   consing_since_gc = 0;
+  alloc_sample_countdown = ALLOC_SAMPLE_NEVER;
   gc_cons_threshold = 100000;
+  gc_trigger = gc_cons_threshold;
+  gc_cons_percentage = 10;
+  gc_pause_target = 0;
+  gc_idle_percentage = 50;
+  gc_minors_per_major = 8;
 #ifdef VIRT_ADDR_VARIES
   malloc_sbrk_unused = 1<<22;	/* A large number */
   malloc_sbrk_used = 100000;	/* as reasonable as any number */
@@ -1249,7 +2638,42 @@ void
 syms_of_alloc ()
 {
   DefIntVar ("gc-cons-threshold", &gc_cons_threshold,
-    "*Number of bytes of consing between garbage collections.");
+    "*Least number of bytes of consing between garbage collections.\n\
+The actual number may be larger; see gc-cons-percentage and gc-pause-target.");
+
+  DefIntVar ("gc-cons-percentage", &gc_cons_percentage,
+    "*Percentage of the live heap to allow consing between garbage collections.\n\
+With a big heap, this makes collections less frequent than\n\
+gc-cons-threshold alone would.  Zero means use gc-cons-threshold alone.");
+
+  DefIntVar ("gc-pause-target", &gc_pause_target,
+    "*If positive, milliseconds that a minor garbage collection should take.\n\
+When collections take longer than this, they are made more frequent,\n\
+and so each one has less to do, even below gc-cons-threshold.");
+
+  DefIntVar ("gc-idle-percentage", &gc_idle_percentage,
+    "*Collect garbage while waiting for input once consing reaches this\n\
+percentage of the amount that would cause a collection.\n\
+Zero means do not collect garbage while waiting for input.");
+
+  DefIntVar ("gc-live-bytes", &gc_live_bytes,
+    "Approximate number of bytes of Lisp data in use after the last collection.");
+
+  DefIntVar ("gc-minor-collections", &gc_minors_per_major,
+    "*Number of minor garbage collections to do between major ones.\n\
+A minor collection reclaims only conses and strings made since the\n\
+previous collection, so it is much faster than a major one.\n\
+Zero means every collection is a major one.");
+
+  DefIntVar ("gc-mark-time", &gc_mark_usecs,
+    "Microseconds taken by the mark phase of the last garbage collection.");
+
+  DefIntVar ("gc-mark-depth", &gc_mark_max_depth,
+    "Greatest depth of the mark stack during the last garbage collection.");
+
+  DefIntVar ("gc-mark-overflows", &gc_mark_overflows,
+    "Number of times the mark stack overflowed in the last garbage collection.\n\
+Each overflow makes the collector rescan the marked objects.");
 
   DefIntVar ("pure-bytes-used", &pureptr,
     "Number of bytes of sharable Lisp data allocated so far.");
@@ -1273,4 +2697,10 @@ syms_of_alloc ()
   defsubr (&Smake_marker);
   defsubr (&Spurecopy);
   defsubr (&Sgarbage_collect);
+  defsubr (&Salloc_profile_start);
+  defsubr (&Salloc_profile_stop);
+  defsubr (&Salloc_profile_data);
+
+  alloc_profile = Qnil;
+  staticpro (&alloc_profile);
 }
@@ -229,6 +229,7 @@ reset_buffer_local_variables(b)
   b->mode_line_format = Vdefault_mode_line_format;
   b->auto_fill_hook = Qnil;
   b->local_var_alist = Qnil;
+  b->local_var_slots = Qnil;
   b->ctl_arrow = default_ctl_arrow ? Qt : Qnil;
   b->truncate_lines = default_truncate_lines ? Qt : Qnil;
   b->selective_display = Qnil;
@@ -544,6 +545,7 @@ record_buffer (buf)
   aelt = Frassq (buf, Vbuffer_alist);
   link = Fmemq (aelt, Vbuffer_alist);
   XCONS(link)->cdr = Fdelq (aelt, Vbuffer_alist);
+  remember_cons (link);
   Vbuffer_alist = link;
 }
 
@@ -655,8 +657,8 @@ SetBfp (p)
   register struct buffer *c = bf_cur;
   register struct window *w = XWINDOW (selected_window);
   register struct buffer *swb;
-  Lisp_Object tail, valcontents;
-  enum Lisp_Type tem;
+  Lisp_Object tail, valcontents, sym;
+  extern Lisp_Object forwarded_local_symbols, buffer_local_cell ();
 
   if (c == p)
     return;
@@ -705,37 +707,20 @@ SetBfp (p)
 	abort ();
     }
 
-  /* Look down buffer's list of local Lisp variables
-     to find and update any that forward into C variables. */
+  /* Buffer-local variables that forward into C variables
+     must be set up now for the new buffer, since C code looks at them
+     directly; do so for those local to either buffer.
+     Other buffer-local variables are set up when next referenced.  */
 
-  for (tail = p->local_var_alist; !NULL (tail); tail = XCONS (tail)->cdr)
+  for (tail = forwarded_local_symbols; !NULL (tail); tail = XCONS (tail)->cdr)
     {
-      valcontents = XSYMBOL (XCONS (XCONS (tail)->car)->car)->value;
-      if ((XTYPE (valcontents) == Lisp_Buffer_Local_Value
-	   || XTYPE (valcontents) == Lisp_Some_Buffer_Local_Value)
-	  && (tem = XTYPE (XCONS (valcontents)->car),
-	      (tem == Lisp_Boolfwd || tem == Lisp_Intfwd
-	       || tem == Lisp_Objfwd)))
+      sym = XCONS (tail)->car;
+      if (!NULL (buffer_local_cell (sym, p))
+	  || (c && !NULL (buffer_local_cell (sym, c))))
 	/* Just reference the variable
 	     to cause it to become set for this buffer.  */
-	Fsymbol_value (XCONS (XCONS (tail)->car)->car);
+	Fsymbol_value (sym);
     }
-
-  /* Do the same with any others that were local to the previous buffer */
-
-  if (c)
-    for (tail = c->local_var_alist; !NULL (tail); tail = XCONS (tail)->cdr)
-      {
-	valcontents = XSYMBOL (XCONS (XCONS (tail)->car)->car)->value;
-	if ((XTYPE (valcontents) == Lisp_Buffer_Local_Value
-	     || XTYPE (valcontents) == Lisp_Some_Buffer_Local_Value)
-	    && (tem = XTYPE (XCONS (valcontents)->car),
-		(tem == Lisp_Boolfwd || tem == Lisp_Intfwd
-		 || tem == Lisp_Objfwd)))
-	  /* Just reference the variable
-               to cause it to become set for this buffer.  */
-	  Fsymbol_value (XCONS (XCONS (tail)->car)->car);
-      }
   /* Vcheck_symbol is set up to the symbol paragraph-start
      in order to check for the bug that clobbers it.  */
   if (EQ (p->major_mode, Qlisp_mode)
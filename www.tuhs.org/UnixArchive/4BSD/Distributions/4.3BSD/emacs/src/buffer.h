@@ -92,6 +92,9 @@ struct buffer
   /* Alist of elements (SYMBOL . VALUE-IN-THIS-BUFFER)
      for all per-buffer variables of this buffer.  */
     Lisp_Object local_var_alist;
+  /* Vector indexed by the local_index of a symbol; the element is
+     that symbol's element of local_var_alist, or nil.  */
+    Lisp_Object local_var_slots;
 
     /* Position in buffer at which display started
        the last time this buffer was displayed */
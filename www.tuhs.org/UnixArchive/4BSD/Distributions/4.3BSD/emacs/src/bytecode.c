@@ -118,9 +118,11 @@ Lisp_Object Qbytecode;
 #define Bconstant 0300
 #define CONSTANTLIM 0100
 
-/* Fetch the next byte from the bytecode stream */
+/* Fetch the next byte from the bytecode stream.
+ Garbage collection never moves a string,
+ so pc points straight into the data of the bytecode string.  */
 
-#define FETCH ((unsigned char *)XSTRING (bytestr)->data)[pc++]
+#define FETCH (*pc++)
 
 /* Fetch two bytes from the bytecode stream
  and make a 16-bit number out of them */
@@ -143,6 +145,62 @@ Lisp_Object Qbytecode;
 
 #define TOP (*stackp)
 
+/* Non-nil means count each byte code executed in byte-code-meter.  */
+
+int byte_metering_on;
+
+Lisp_Object Vbyte_code_meter;
+
+/* Code run from inside an instruction can set byte-code-meter,
+ so check it each time rather than once in Fbyte_code.
+ A count stops at the largest fixnum rather than overflowing
+ into the type bits; anything that is not a count that small,
+ such as a negative number or a non-number, is left alone.  */
+
+#define METER_CODE(op) \
+  if (byte_metering_on && XTYPE (Vbyte_code_meter) == Lisp_Vector \
+      && XVECTOR (Vbyte_code_meter)->size == 0400 \
+      && (XFASTINT (XVECTOR (Vbyte_code_meter)->contents[op]) \
+	  < MOST_POSITIVE_FIXNUM)) \
+    XFASTINT (XVECTOR (Vbyte_code_meter)->contents[op])++
+
+/* With GNU C, the code for each instruction jumps straight to the code
+ for the next one, through a table of label addresses, rather than
+ going back to a switch; this saves a jump and a range check, and each
+ of these jumps is predicted separately.  Define BYTE_CODE_SWITCH
+ to use the switch anyway.
+
+ OPCODE (op) starts the code for opcode `op', whose label is L_op.
+ CASE (op) adds another opcode to the switch; the table sends it
+ to the same label.  NEXT goes on to the next instruction.  */
+
+#if defined (__GNUC__) && !defined (BYTE_CODE_SWITCH)
+#define BYTE_CODE_THREADED
+#endif
+
+/* Define BYTE_CODE_SAFE to check the stack pointer at each instruction.  */
+
+#ifdef BYTE_CODE_SAFE
+#define CHECK_STACK \
+  { if (stackp > stacke) \
+      error ("Stack overflow in byte code (byte compiler bug!)"); \
+    if (stackp < stack) \
+      error ("Stack underflow in byte code (byte compiler bug!)"); }
+#else
+#define CHECK_STACK
+#endif
+
+#ifdef BYTE_CODE_THREADED
+#define OPCODE(op) L_##op:
+#define CASE(op)
+#define LABEL(name) L_##name:
+#define NEXT { CHECK_STACK; op = FETCH; METER_CODE (op); goto *dispatch[op]; }
+#else
+#define OPCODE(op) case op:
+#define CASE(op) case op:
+#define LABEL(name)
+#define NEXT break
+#endif
 
 DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
   "")
@@ -151,7 +209,8 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 {
   struct gcpro gcpro1, gcpro2, gcpro3;
   int count = specpdl_ptr - specpdl;
-  register int pc = 0;
+  register unsigned char *pc;
+  unsigned char *pcbase;
   register int op;
   Lisp_Object *stack;
   register Lisp_Object *stackp;
@@ -159,11 +218,123 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
   register Lisp_Object v1, v2;
   Lisp_Object *vectorp = XVECTOR (vector)->contents;
 
+#ifdef BYTE_CODE_THREADED
+  static void *dispatch[0400] =
+    {
+      [0 ... 0377] = &&L_Bdefault,
+
+      [Bvarref ... Bvarref+5] = &&L_Bvarref,
+      [Bvarref+6] = &&L_Bvarref6,
+      [Bvarref+7] = &&L_Bvarref7,
+      [Bvarset ... Bvarset+5] = &&L_Bvarset,
+      [Bvarset+6] = &&L_Bvarset6,
+      [Bvarset+7] = &&L_Bvarset7,
+      [Bvarbind ... Bvarbind+5] = &&L_Bvarbind,
+      [Bvarbind+6] = &&L_Bvarbind6,
+      [Bvarbind+7] = &&L_Bvarbind7,
+      [Bcall ... Bcall+5] = &&L_Bcall,
+      [Bcall+6] = &&L_Bcall6,
+      [Bcall+7] = &&L_Bcall7,
+      [Bunbind ... Bunbind+5] = &&L_Bunbind,
+      [Bunbind+6] = &&L_Bunbind6,
+      [Bunbind+7] = &&L_Bunbind7,
+
+      [Bnth] = &&L_Bnth,
+      [Bsymbolp] = &&L_Bsymbolp,
+      [Bconsp] = &&L_Bconsp,
+      [Bstringp] = &&L_Bstringp,
+      [Blistp] = &&L_Blistp,
+      [Beq] = &&L_Beq,
+      [Bmemq] = &&L_Bmemq,
+      [Bnot] = &&L_Bnot,
+      [Bcar] = &&L_Bcar,
+      [Bcdr] = &&L_Bcdr,
+      [Bcons] = &&L_Bcons,
+      [Blist1] = &&L_Blist1,
+      [Blist2] = &&L_Blist2,
+      [Blist3] = &&L_Blist3,
+      [Blist4] = &&L_Blist4,
+      [Blength] = &&L_Blength,
+      [Baref] = &&L_Baref,
+      [Baset] = &&L_Baset,
+      [Bsymbol_value] = &&L_Bsymbol_value,
+      [Bsymbol_function] = &&L_Bsymbol_function,
+      [Bset] = &&L_Bset,
+      [Bfset] = &&L_Bfset,
+      [Bget] = &&L_Bget,
+      [Bsubstring] = &&L_Bsubstring,
+      [Bconcat2] = &&L_Bconcat2,
+      [Bconcat3] = &&L_Bconcat3,
+      [Bconcat4] = &&L_Bconcat4,
+      [Bsub1] = &&L_Bsub1,
+      [Badd1] = &&L_Badd1,
+      [Beqlsign] = &&L_Beqlsign,
+      [Bgtr] = &&L_Bgtr,
+      [Blss] = &&L_Blss,
+      [Bleq] = &&L_Bleq,
+      [Bgeq] = &&L_Bgeq,
+      [Bdiff] = &&L_Bdiff,
+      [Bnegate] = &&L_Bnegate,
+      [Bplus] = &&L_Bplus,
+      [Bmax] = &&L_Bmax,
+      [Bmin] = &&L_Bmin,
+
+      [Bpoint] = &&L_Bpoint,
+      [Bmark] = &&L_Bmark,
+      [Bgoto_char] = &&L_Bgoto_char,
+      [Binsert] = &&L_Binsert,
+      [Bpoint_max] = &&L_Bpoint_max,
+      [Bpoint_min] = &&L_Bpoint_min,
+      [Bchar_after] = &&L_Bchar_after,
+      [Bfollowing_char] = &&L_Bfollowing_char,
+      [Bpreceding_char] = &&L_Bpreceding_char,
+      [Bcurrent_column] = &&L_Bcurrent_column,
+      [Bindent_to] = &&L_Bindent_to,
+      [Bscan_buffer] = &&L_Bscan_buffer,
+      [Beolp] = &&L_Beolp,
+      [Beobp] = &&L_Beobp,
+      [Bbolp] = &&L_Bbolp,
+      [Bbobp] = &&L_Bbobp,
+      [Bcurrent_buffer] = &&L_Bcurrent_buffer,
+      [Bset_buffer] = &&L_Bset_buffer,
+      [Bread_char] = &&L_Bread_char,
+      [Bset_mark] = &&L_Bset_mark,
+      [Binteractive_p] = &&L_Binteractive_p,
+
+      [Bconstant2] = &&L_Bconstant2,
+      [Bgoto] = &&L_Bgoto,
+      [Bgotoifnil] = &&L_Bgotoifnil,
+      [Bgotoifnonnil] = &&L_Bgotoifnonnil,
+      [Bgotoifnilelsepop] = &&L_Bgotoifnilelsepop,
+      [Bgotoifnonnilelsepop] = &&L_Bgotoifnonnilelsepop,
+      [Breturn] = &&L_Breturn,
+      [Bdiscard] = &&L_Bdiscard,
+      [Bdup] = &&L_Bdup,
+
+      [Bsave_excursion] = &&L_Bsave_excursion,
+      [Bsave_window_excursion] = &&L_Bsave_window_excursion,
+      [Bsave_restriction] = &&L_Bsave_restriction,
+      [Bcatch] = &&L_Bcatch,
+
+      [Bunwind_protect] = &&L_Bunwind_protect,
+      [Bcondition_case] = &&L_Bcondition_case,
+      [Btemp_output_buffer_setup] = &&L_Btemp_output_buffer_setup,
+      [Btemp_output_buffer_show] = &&L_Btemp_output_buffer_show,
+
+      [Bconstant ... Bconstant+CONSTANTLIM-1] = &&L_Bconstant
+    };
+#endif /* BYTE_CODE_THREADED */
+
   CHECK_STRING (bytestr, 0);
   if (XTYPE (vector) != Lisp_Vector)
     vector = wrong_type_argument (Qvectorp, vector);
   CHECK_NUMBER (maxdepth, 2);
 
+  if (byte_metering_on
+      && (XTYPE (Vbyte_code_meter) != Lisp_Vector
+	  || XVECTOR (Vbyte_code_meter)->size != 0400))
+    Vbyte_code_meter = Fmake_vector (make_number (0400), make_number (0));
+
   stackp = (Lisp_Object *) alloca (XFASTINT (maxdepth) * sizeof (Lisp_Object));
   bzero (stackp, XFASTINT (maxdepth) * sizeof (Lisp_Object));
   GCPRO3 (bytestr, vector, *stackp);
@@ -173,177 +344,202 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
   stack = stackp;
   stacke = stackp + XFASTINT (maxdepth);
 
+  pc = pcbase = XSTRING (bytestr)->data;
+
+#ifdef BYTE_CODE_THREADED
+  NEXT;
+#else
   while (1)
     {
-      if (stackp > stacke)
-	error ("Stack overflow in byte code (byte compiler bug!)");
-      if (stackp < stack)
-	error ("Stack underflow in byte code (byte compiler bug!)");
-      switch (op = FETCH)
+      CHECK_STACK;
+      op = FETCH;
+      METER_CODE (op);
+      switch (op)
+#endif
 	{
-	case Bvarref: case Bvarref+1: case Bvarref+2: case Bvarref+3:
-	case Bvarref+4: case Bvarref+5:
-	  PUSH (Fsymbol_value (vectorp[op - Bvarref]));
-	  break;
+	CASE (Bvarref+1) CASE (Bvarref+2) CASE (Bvarref+3)
+	CASE (Bvarref+4) CASE (Bvarref+5)
+	OPCODE (Bvarref)
+	  op -= Bvarref;
+	dovarref:
+	  PUSH (Fsymbol_value (vectorp[op]));
+	  /* Superinstructions: do a following car or cdr right here.  */
+	  if (*pc == Bcar)
+	    {
+	      pc++;
+	      METER_CODE (Bcar);
+	      goto docar;
+	    }
+	  if (*pc == Bcdr)
+	    {
+	      pc++;
+	      METER_CODE (Bcdr);
+	      goto docdr;
+	    }
+	  NEXT;
 
-	case Bvarref+6:
-	  PUSH (Fsymbol_value (vectorp[FETCH]));
-	  break;
+	CASE (Bvarref+6) LABEL (Bvarref6)
+	  op = FETCH;
+	  goto dovarref;
 
-	case Bvarref+7:
-	  PUSH (Fsymbol_value (vectorp[FETCH2]));
-	  break;
+	CASE (Bvarref+7) LABEL (Bvarref7)
+	  op = FETCH2;
+	  goto dovarref;
 
-	case Bvarset: case Bvarset+1: case Bvarset+2: case Bvarset+3:
-	case Bvarset+4: case Bvarset+5:
+	CASE (Bvarset+1) CASE (Bvarset+2) CASE (Bvarset+3)
+	CASE (Bvarset+4) CASE (Bvarset+5)
+	OPCODE (Bvarset)
 	  Fset (vectorp[op - Bvarset], POP);
-	  break;
+	  NEXT;
 
-	case Bvarset+6:
+	CASE (Bvarset+6) LABEL (Bvarset6)
 	  Fset (vectorp[FETCH], POP);
-	  break;
+	  NEXT;
 
-	case Bvarset+7:
+	CASE (Bvarset+7) LABEL (Bvarset7)
 	  Fset (vectorp[FETCH2], POP);
-	  break;
+	  NEXT;
 
-	case Bvarbind: case Bvarbind+1: case Bvarbind+2: case Bvarbind+3:
-	case Bvarbind+4: case Bvarbind+5:
+	CASE (Bvarbind+1) CASE (Bvarbind+2) CASE (Bvarbind+3)
+	CASE (Bvarbind+4) CASE (Bvarbind+5)
+	OPCODE (Bvarbind)
 	  specbind (vectorp[op - Bvarbind], POP);
-	  break;
+	  NEXT;
 
-	case Bvarbind+6:
+	CASE (Bvarbind+6) LABEL (Bvarbind6)
 	  specbind (vectorp[FETCH], POP);
-	  break;
+	  NEXT;
 
-	case Bvarbind+7:
+	CASE (Bvarbind+7) LABEL (Bvarbind7)
 	  specbind (vectorp[FETCH2], POP);
-	  break;
+	  NEXT;
 
-	case Bcall: case Bcall+1: case Bcall+2: case Bcall+3:
-	case Bcall+4: case Bcall+5:
+	CASE (Bcall+1) CASE (Bcall+2) CASE (Bcall+3)
+	CASE (Bcall+4) CASE (Bcall+5)
+	OPCODE (Bcall)
 	  op -= Bcall;
 	docall:
 	  DISCARD(op);
 	  gcpro3.nvars = &TOP - stack;
-	  TOP = Ffuncall (op + 1, &TOP);
+	  TOP = funcall_from ((LISP_WORD) pc, op + 1, &TOP);
 	  gcpro3.nvars = XFASTINT (maxdepth);
-	  break;
+	  NEXT;
 
-	case Bcall+6:
+	CASE (Bcall+6) LABEL (Bcall6)
 	  op = FETCH;
 	  goto docall;
 
-	case Bcall+7:
+	CASE (Bcall+7) LABEL (Bcall7)
 	  op = FETCH2;
 	  goto docall;
 
-	case Bunbind: case Bunbind+1: case Bunbind+2: case Bunbind+3:
-	case Bunbind+4: case Bunbind+5:
+	CASE (Bunbind+1) CASE (Bunbind+2) CASE (Bunbind+3)
+	CASE (Bunbind+4) CASE (Bunbind+5)
+	OPCODE (Bunbind)
 	  unbind_to (specpdl_ptr - specpdl - (op - Bunbind));
-	  break;
+	  NEXT;
 
-	case Bunbind+6:
+	CASE (Bunbind+6) LABEL (Bunbind6)
 	  unbind_to (specpdl_ptr - specpdl - FETCH);
-	  break;
+	  NEXT;
 
-	case Bunbind+7:
+	CASE (Bunbind+7) LABEL (Bunbind7)
 	  unbind_to (specpdl_ptr - specpdl - FETCH2);
-	  break;
+	  NEXT;
 
-	case Bgoto:
+	OPCODE (Bgoto)
 	  QUIT;
 	  op = FETCH2;    /* pc = FETCH2 loses since FETCH2 contains pc++ */
-	  pc = op;
-	  break;
+	  pc = pcbase + op;
+	  NEXT;
 
-	case Bgotoifnil:
+	OPCODE (Bgotoifnil)
 	  QUIT;
 	  op = FETCH2;
 	  if (NULL (POP))
-	    pc = op;
-	  break;
+	    pc = pcbase + op;
+	  NEXT;
 
-	case Bgotoifnonnil:
+	OPCODE (Bgotoifnonnil)
 	  QUIT;
 	  op = FETCH2;
 	  if (!NULL (POP))
-	    pc = op;
-	  break;
+	    pc = pcbase + op;
+	  NEXT;
 
-	case Bgotoifnilelsepop:
+	OPCODE (Bgotoifnilelsepop)
 	  QUIT;
 	  op = FETCH2;
 	  if (NULL (TOP))
-	    pc = op;
+	    pc = pcbase + op;
 	  else DISCARD(1);
-	  break;
+	  NEXT;
 
-	case Bgotoifnonnilelsepop:
+	OPCODE (Bgotoifnonnilelsepop)
 	  QUIT;
 	  op = FETCH2;
 	  if (!NULL (TOP))
-	    pc = op;
+	    pc = pcbase + op;
 	  else DISCARD(1);
-	  break;
+	  NEXT;
 
-	case Breturn:
+	OPCODE (Breturn)
 	  v1 = POP;
 	  goto exit;
 
-	case Bdiscard:
+	OPCODE (Bdiscard)
 	  DISCARD(1);
-	  break;
+	  NEXT;
 
-	case Bdup:
+	OPCODE (Bdup)
 	  v1 = TOP;
 	  PUSH (v1);
-	  break;
+	  NEXT;
 
-	case Bconstant2:
+	OPCODE (Bconstant2)
 	  PUSH (vectorp[FETCH2]);
-	  break;
+	  NEXT;
 
-	case Bsave_excursion:
+	OPCODE (Bsave_excursion)
 	  record_unwind_protect (save_excursion_restore, save_excursion_save ());
-	  break;
+	  NEXT;
 
-	case Bsave_window_excursion:
+	OPCODE (Bsave_window_excursion)
 	  TOP = Fsave_window_excursion (TOP);
-	  break;
+	  NEXT;
 
-	case Bsave_restriction:
+	OPCODE (Bsave_restriction)
 	  record_unwind_protect (save_restriction_restore, save_restriction_save ());
-	  break;
+	  NEXT;
 
-	case Bcatch:
+	OPCODE (Bcatch)
 	  v1 = POP;
 	  TOP = internal_catch (TOP, Feval, v1);
-	  break;
+	  NEXT;
 
-	case Bunwind_protect:
+	OPCODE (Bunwind_protect)
 	  record_unwind_protect (0, POP);
 	  (specpdl_ptr - 1)->symbol = Qnil;
-	  break;
+	  NEXT;
 
-	case Bcondition_case:
+	OPCODE (Bcondition_case)
 	  v1 = POP;
 	  v1 = Fcons (POP, v1);
 	  TOP = Fcondition_case (Fcons (TOP, v1));
-	  break;
+	  NEXT;
 
-	case Btemp_output_buffer_setup:
+	OPCODE (Btemp_output_buffer_setup)
 	  temp_output_buffer_setup (XSTRING (TOP)->data);
 	  TOP = Vstandard_output;
-	  break;
+	  NEXT;
 
-	case Btemp_output_buffer_show:
+	OPCODE (Btemp_output_buffer_show)
 	  v1 = POP;
 	  temp_output_buffer_show (TOP);
 	  TOP = v1;
-	  break;
+	  NEXT;
 
-	case Bnth:
+	OPCODE (Bnth)
 	  v1 = POP;
 	  v2 = TOP;
 	  CHECK_NUMBER (v2, 0);
@@ -358,135 +554,137 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 		  op++;
 		}
 	    }
-	  goto docar;
+	  goto docar1;
 
-	case Bsymbolp:
+	OPCODE (Bsymbolp)
 	  TOP = XTYPE (TOP) == Lisp_Symbol ? Qt : Qnil;
-	  break;
+	  NEXT;
 
-	case Bconsp:
+	OPCODE (Bconsp)
 	  TOP = LISTP (TOP) ? Qt : Qnil;
-	  break;
+	  NEXT;
 
-	case Bstringp:
+	OPCODE (Bstringp)
 	  TOP = XTYPE (TOP) == Lisp_String ? Qt : Qnil;
-	  break;
+	  NEXT;
 
-	case Blistp:
+	OPCODE (Blistp)
 	  TOP = LISTP (TOP) || NULL (TOP) ? Qt : Qnil;
-	  break;
+	  NEXT;
 
-	case Beq:
+	OPCODE (Beq)
 	  v1 = POP;
 	  TOP = EQ (v1, TOP) ? Qt : Qnil;
-	  break;
+	  NEXT;
 
-	case Bmemq:
+	OPCODE (Bmemq)
 	  v1 = POP;
 	  TOP = Fmemq (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Bnot:
+	OPCODE (Bnot)
 	  TOP = NULL (TOP) ? Qt : Qnil;
-	  break;
+	  NEXT;
 
-	case Bcar:
-	  v1 = TOP;
+	OPCODE (Bcar)
 	docar:
+	  v1 = TOP;
+	docar1:
 	  if (LISTP (v1)) TOP = XCONS (v1)->car;
 	  else if (NULL (v1)) TOP = Qnil;
 	  else Fcar (wrong_type_argument (Qlistp, v1));
-	  break;
+	  NEXT;
 
-	case Bcdr:
+	OPCODE (Bcdr)
+	docdr:
 	  v1 = TOP;
 	  if (LISTP (v1)) TOP = XCONS (v1)->cdr;
 	  else if (NULL (v1)) TOP = Qnil;
 	  else Fcdr (wrong_type_argument (Qlistp, v1));
-	  break;
+	  NEXT;
 
-	case Bcons:
+	OPCODE (Bcons)
 	  v1 = POP;
 	  TOP = Fcons (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Blist1:
+	OPCODE (Blist1)
 	  TOP = Fcons (TOP, Qnil);
-	  break;
+	  NEXT;
 
-	case Blist2:
+	OPCODE (Blist2)
 	  v1 = POP;
 	  TOP = Fcons (TOP, Fcons (v1, Qnil));
-	  break;
+	  NEXT;
 
-	case Blist3:
+	OPCODE (Blist3)
 	  DISCARD(2);
 	  TOP = Flist (3, &TOP);
-	  break;
+	  NEXT;
 
-	case Blist4:
+	OPCODE (Blist4)
 	  DISCARD(3);
 	  TOP = Flist (4, &TOP);
-	  break;
+	  NEXT;
 
-	case Blength:
+	OPCODE (Blength)
 	  TOP = Flength (TOP);
-	  break;
+	  NEXT;
 
-	case Baref:
+	OPCODE (Baref)
 	  v1 = POP;
 	  TOP = Faref (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Baset:
+	OPCODE (Baset)
 	  v2 = POP; v1 = POP;
 	  TOP = Faset (TOP, v1, v2);
-	  break;
+	  NEXT;
 
-	case Bsymbol_value:
+	OPCODE (Bsymbol_value)
 	  TOP = Fsymbol_value (TOP);
-	  break;
+	  NEXT;
 
-	case Bsymbol_function:
+	OPCODE (Bsymbol_function)
 	  TOP = Fsymbol_function (TOP);
-	  break;
+	  NEXT;
 
-	case Bset:
+	OPCODE (Bset)
 	  v1 = POP;
 	  TOP = Fset (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Bfset:
+	OPCODE (Bfset)
 	  v1 = POP;
 	  TOP = Ffset (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Bget:
+	OPCODE (Bget)
 	  v1 = POP;
 	  TOP = Fget (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Bsubstring:
+	OPCODE (Bsubstring)
 	  v2 = POP; v1 = POP;
 	  TOP = Fsubstring (TOP, v1, v2);
-	  break;
+	  NEXT;
 
-	case Bconcat2:
+	OPCODE (Bconcat2)
 	  DISCARD(1);
 	  TOP = Fconcat (2, &TOP);
-	  break;
+	  NEXT;
 
-	case Bconcat3:
+	OPCODE (Bconcat3)
 	  DISCARD(2);
 	  TOP = Fconcat (3, &TOP);
-	  break;
+	  NEXT;
 
-	case Bconcat4:
+	OPCODE (Bconcat4)
 	  DISCARD(3);
 	  TOP = Fconcat (4, &TOP);
-	  break;
+	  NEXT;
 
-	case Bsub1:
+	OPCODE (Bsub1)
 	  v1 = TOP;
 	  if (XTYPE (v1) == Lisp_Int)
 	    {
@@ -495,9 +693,9 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 	    }
 	  else
 	    TOP = Fsub1 (v1);
-	  break;
+	  NEXT;
 
-	case Badd1:
+	OPCODE (Badd1)
 	  v1 = TOP;
 	  if (XTYPE (v1) == Lisp_Int)
 	    {
@@ -506,41 +704,41 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 	    }
 	  else
 	    TOP = Fadd1 (v1);
-	  break;
+	  NEXT;
 
-	case Beqlsign:
+	OPCODE (Beqlsign)
 	  v2 = POP; v1 = TOP;
 	  CHECK_NUMBER_COERCE_MARKER (v1, 0);
 	  CHECK_NUMBER_COERCE_MARKER (v2, 0);
 	  TOP = XINT (v1) == XINT (v2) ? Qt : Qnil;
-	  break;
+	  NEXT;
 
-	case Bgtr:
+	OPCODE (Bgtr)
 	  v1 = POP;
 	  TOP = Fgtr (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Blss:
+	OPCODE (Blss)
 	  v1 = POP;
 	  TOP = Flss (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Bleq:
+	OPCODE (Bleq)
 	  v1 = POP;
 	  TOP = Fleq (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Bgeq:
+	OPCODE (Bgeq)
 	  v1 = POP;
 	  TOP = Fgeq (TOP, v1);
-	  break;
+	  NEXT;
 
-	case Bdiff:
+	OPCODE (Bdiff)
 	  DISCARD(1);
 	  TOP = Fminus (2, &TOP);
-	  break;
+	  NEXT;
 
-	case Bnegate:
+	OPCODE (Bnegate)
 	  v1 = TOP;
 	  if (XTYPE (v1) == Lisp_Int)
 	    {
@@ -549,120 +747,139 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 	    }
 	  else
 	    TOP = Fminus (1, &TOP);
-	  break;
+	  NEXT;
 
-	case Bplus:
+	OPCODE (Bplus)
 	  DISCARD(1);
 	  TOP = Fplus (2, &TOP);
-	  break;
+	  NEXT;
 
-	case Bmax:
+	OPCODE (Bmax)
 	  DISCARD(1);
 	  TOP = Fmax (2, &TOP);
-	  break;
+	  NEXT;
 
-	case Bmin:
+	OPCODE (Bmin)
 	  DISCARD(1);
 	  TOP = Fmin (2, &TOP);
-	  break;
+	  NEXT;
 
-	case Bpoint:
+	OPCODE (Bpoint)
 	  XFASTINT (v1) = point;
 	  PUSH (v1);
-	  break;
+	  NEXT;
 
-	case Bmark:
+	OPCODE (Bmark)
 	  PUSH (Fmark ());
-	  break;
+	  NEXT;
 
-	case Bgoto_char:
+	OPCODE (Bgoto_char)
 	  TOP = Fgoto_char (TOP);
-	  break;
+	  NEXT;
 
-	case Binsert:
+	OPCODE (Binsert)
 	  TOP = Finsert (1, &TOP);
-	  break;
+	  NEXT;
 
-	case Bpoint_max:
+	OPCODE (Bpoint_max)
 	  XFASTINT (v1) = NumCharacters+1;
 	  PUSH (v1);
-	  break;
+	  NEXT;
 
-	case Bpoint_min:
+	OPCODE (Bpoint_min)
 	  XFASTINT (v1) = FirstCharacter;
 	  PUSH (v1);
-	  break;
+	  NEXT;
 
-	case Bchar_after:
+	OPCODE (Bchar_after)
 	  TOP = Fchar_after (TOP);
-	  break;
+	  NEXT;
 
-	case Bfollowing_char:
+	OPCODE (Bfollowing_char)
 	  XFASTINT (v1) = point>NumCharacters ? 0 : CharAt(point);
 	  PUSH (v1);
-	  break;
+	  NEXT;
 
-	case Bpreceding_char:
+	OPCODE (Bpreceding_char)
 	  XFASTINT (v1) = point<=FirstCharacter ? 0 : CharAt(point-1);
 	  PUSH (v1);
-	  break;
+	  NEXT;
 
-	case Bcurrent_column:
+	OPCODE (Bcurrent_column)
 	  XFASTINT (v1) = current_column ();
 	  PUSH (v1);
-	  break;
+	  NEXT;
 
-	case Bindent_to:
+	OPCODE (Bindent_to)
 	  TOP = Findent_to (TOP, Qnil);
-	  break;
+	  NEXT;
 
-	case Bscan_buffer:
+	OPCODE (Bscan_buffer)
 	  v2 = POP; v1 = POP;
 	  TOP = Fscan_buffer (TOP, v1, v2);
-	  break;
+	  NEXT;
 
-	case Beolp:
+	OPCODE (Beolp)
 	  PUSH (Feolp ());
-	  break;
+	  NEXT;
 
-	case Beobp:
+	OPCODE (Beobp)
 	  PUSH (Feobp ());
-	  break;
+	  NEXT;
 
-	case Bbolp:
+	OPCODE (Bbolp)
 	  PUSH (Fbolp ());
-	  break;
+	  NEXT;
 
-	case Bbobp:
+	OPCODE (Bbobp)
 	  PUSH (Fbobp ());
-	  break;
+	  NEXT;
 
-	case Bcurrent_buffer:
+	OPCODE (Bcurrent_buffer)
 	  PUSH (Fcurrent_buffer ());
-	  break;
+	  NEXT;
 
-	case Bset_buffer:
+	OPCODE (Bset_buffer)
 	  TOP = Fset_buffer (TOP);
-	  break;
+	  NEXT;
 
-	case Bread_char:
+	OPCODE (Bread_char)
 	  PUSH (Fread_char ());
 	  QUIT;
-	  break;
+	  NEXT;
 
-	case Bset_mark:
+	OPCODE (Bset_mark)
 	  TOP = Fset_mark (TOP);
-	  break;
+	  NEXT;
 
-	case Binteractive_p:
+	OPCODE (Binteractive_p)
 	  PUSH (Finteractive_p ());
-	  break;
+	  NEXT;
 
+#ifdef BYTE_CODE_THREADED
+	LABEL (Bdefault)
+	  NEXT;
+#else
 	default:
-	  if ((op -= Bconstant) < (unsigned)CONSTANTLIM)
-	    PUSH (vectorp[op]);
+	  if ((unsigned) (op - Bconstant) >= CONSTANTLIM)
+	    break;
+#endif
+	LABEL (Bconstant)
+	  PUSH (vectorp[op - Bconstant]);
+	  /* Superinstruction: a constant followed by a call
+	     with no arguments calls that constant right here.  */
+	  if (*pc == Bcall)
+	    {
+	      pc++;
+	      METER_CODE (Bcall);
+	      op = 0;
+	      goto docall;
+	    }
+	  NEXT;
 	}
+#ifndef BYTE_CODE_THREADED
     }
+#endif
 
  exit:
   UNGCPRO;
@@ -675,6 +892,15 @@ syms_of_bytecode ()
   Qbytecode = intern ("byte-code");
   staticpro (&Qbytecode);
 
+  DefBoolVar ("byte-metering-on", &byte_metering_on,
+    "*Non-nil means count the byte codes executed, in byte-code-meter.");
+
+  DefLispVar ("byte-code-meter", &Vbyte_code_meter,
+    "Vector of the number of times each byte code has been executed.\n\
+Element N counts opcode N; it is counted only while byte-metering-on\n\
+is non-nil.  Byte codes that are run together as one step\n\
+are each counted.");
+  Vbyte_code_meter = Fmake_vector (make_number (0400), make_number (0));
+
   defsubr (&Sbyte_code);
 }
-
@@ -69,6 +69,7 @@ quotify_args (exp)
     {
       ptr = XCONS (tail);
       ptr->car = quotify_arg (ptr->car);
+      remember_cons (tail);
     }
   return exp;
 }
@@ -125,7 +126,7 @@ retry:
 	  function = wrong_type_argument (Qcommandp, function, 0);
 	  goto retry;
 	}
-      else if ((int) string == 1)
+      else if (string == (unsigned char *) 1)
 	return Fapply (function, Qnil);
     }
   else if (!LISTP (fun))
@@ -290,13 +291,13 @@ retry:
 
 	case 'P':		/* Prefix arg in raw form.  Does no I/O.  */
 	  args[i] = prefix_arg;
-	  XFASTINT (visargs[i]) = (int) "";
+	  visargs[i] = build_string ("");
 	  varies[i] = -1;
 	  break;
 
 	case 'p':		/* Prefix arg converted to number.  No I/O. */
 	  args[i] = Fprefix_numeric_value (prefix_arg);
-	  XFASTINT (visargs[i]) = (int) "";
+	  visargs[i] = build_string ("");
 	  varies[i] = -1;
 	  break;
 
@@ -374,6 +374,30 @@ cmgoto (row, col)
   curY = row, curX = col;
 }
 
+/* Return the cost in characters of moving the cursor from where it is
+   to (row, col), by relative motion or direct addressing,
+   whichever cmgoto would find cheaper.  */
+
+cmcost (row, col)
+{
+  int relcost, directcost;
+  char *p;
+
+  if (curY < 0 || curX < 0)
+    return BIG;
+  relcost = calccost (curY, curX, row, col, 0);
+  if (row == curY && Wcm.cm_habs)
+    p = tgoto (Wcm.cm_habs, row, col);
+  else if (Wcm.cm_abs)
+    p = tgoto (Wcm.cm_abs, col, row);
+  else
+    return relcost;
+  cost = 0;
+  tputs (p, 1, evalcost);
+  directcost = cost;
+  return directcost < relcost ? directcost : relcost;
+}
+
 /* Clear out all terminal info.
    Used before copying into it the info on the actual terminal.
  */
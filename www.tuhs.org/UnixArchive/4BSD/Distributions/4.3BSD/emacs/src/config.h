@@ -42,9 +42,16 @@ and this notice must be preserved on all copies.  */
     m-pyramid.h for pyramids.
     m-dual68.h  for dual 68000's (that run Unisoft port).
     m-apollo.h  for Apollo running their own system.
+    m-x86-64.h  for 64-bit Intel and AMD machines; chosen below
+		when the compiler says it targets one.  Use it with
+		the s- file for the BSD-derived system they run.
    See m-template.h for info on what m- files should define.
    */
+#ifdef __x86_64__
+#include "m-x86-64.h"
+#else
 #include "m-vax.h"
+#endif
 
 
 /* define HAVE_X_WINDOWS if you want to use the X window system */
@@ -88,7 +95,9 @@ and this notice must be preserved on all copies.  */
 
 /* # bytes of pure Lisp code to leave space for.
   130000 is enough for Emacs as distributed by me, Richard Stallman,
-  with the set of preloaded packages I set up.  */
+  with the set of preloaded packages I set up.
+  Machines with VIRT_ADDR_VARIES and HAVE_MMAP ignore this;
+  pure storage grows as needed, up to PURE_RESERVE bytes.  */
 
 #define PURESIZE 130000
 
@@ -325,6 +325,7 @@ DEFUN ("setcar", Fsetcar, Ssetcar, 2, 2, 0,
 
   CHECK_IMPURE (cell);
   XCONS (cell)->car = newcar;
+  remember_cons (cell);
   return newcar;
 }
 
@@ -338,6 +339,7 @@ DEFUN ("setcdr", Fsetcdr, Ssetcdr, 2, 2, 0,
 
   CHECK_IMPURE (cell);
   XCONS (cell)->cdr = newcdr;
+  remember_cons (cell);
   return newcdr;
 }
 
@@ -378,6 +380,7 @@ DEFUN ("fmakunbound", Ffmakunbound, Sfmakunbound, 1, 1, 0, "Make SYMBOL's functi
 {
   CHECK_SYMBOL (sym, 0);
   XSYMBOL (sym)->function = Qunbound;
+  function_generation++;
   return sym;
 }
 
@@ -421,6 +424,8 @@ DEFUN ("fset", Ffset, Sfset, 2, 2, 0,
     Vautoload_queue = Fcons (Fcons (sym, XSYMBOL (sym)->function),
 			     Vautoload_queue);
   XSYMBOL (sym)->function = newdef;
+  remember_store (sym, newdef);
+  function_generation++;
   return newdef;
 }
 
@@ -431,6 +436,7 @@ DEFUN ("setplist", Fsetplist, Ssetplist, 2, 2, 0,
 {
   CHECK_SYMBOL (sym, 0);
   XSYMBOL (sym)->plist = newplist;
+  remember_store (sym, newplist);
   return newplist;
 }
 
@@ -463,11 +469,81 @@ do_symval_forwarding (valcontents)
       return *XOBJFWD (valcontents);
 
     case Lisp_Buffer_Objfwd:
-      return *(Lisp_Object *)((int)XOBJFWD (valcontents) + (char *)bf_cur);
+      return *(Lisp_Object *)((LISP_WORD) XOBJFWD (valcontents) + (char *)bf_cur);
     }
   return valcontents;
 }
 
+/* Each symbol that has had a buffer-local value has a local_index.
+   Element local_index of a buffer's local_var_slots vector is
+   the symbol's element of that buffer's local_var_alist, or nil,
+   so finding a buffer's value need not search its alist.  */
+
+static int last_local_index;
+
+/* List of buffer-local variables whose values forward into C variables.
+   SetBfp must set these up for the new buffer.  */
+
+Lisp_Object forwarded_local_symbols;
+
+/* Return the element of buffer b's local_var_alist for sym, or nil.  */
+
+Lisp_Object
+buffer_local_cell (sym, b)
+     Lisp_Object sym;
+     struct buffer *b;
+{
+  register int i = XSYMBOL (sym)->local_index;
+
+  if (i == 0 || NULL (b->local_var_slots)
+      || i >= XVECTOR (b->local_var_slots)->size)
+    return Qnil;
+  return XVECTOR (b->local_var_slots)->contents[i];
+}
+
+/* Record cell as buffer b's element of local_var_alist for sym.
+   cell nil means b no longer has one.  */
+
+set_buffer_local_cell (sym, b, cell)
+     Lisp_Object sym, cell;
+     struct buffer *b;
+{
+  register int i = XSYMBOL (sym)->local_index;
+  register int k, size;
+  Lisp_Object new;
+
+  if (i == 0)
+    {
+      if (NULL (cell))
+	return;
+      i = XSYMBOL (sym)->local_index = ++last_local_index;
+    }
+  size = NULL (b->local_var_slots) ? 0 : XVECTOR (b->local_var_slots)->size;
+  if (i >= size)
+    {
+      if (NULL (cell))
+	return;
+      new = Fmake_vector (make_number (i < 2 * size ? 2 * size : i + 16), Qnil);
+      for (k = 0; k < size; k++)
+	XVECTOR (new)->contents[k] = XVECTOR (b->local_var_slots)->contents[k];
+      b->local_var_slots = new;
+    }
+  XVECTOR (b->local_var_slots)->contents[i] = cell;
+  remember_store (b->local_var_slots, cell);
+}
+
+/* Note that sym is becoming buffer-local; valcontents is its old value.  */
+
+static
+note_local_variable (sym, valcontents)
+     Lisp_Object sym, valcontents;
+{
+  if (XTYPE (valcontents) == Lisp_Intfwd
+      || XTYPE (valcontents) == Lisp_Boolfwd
+      || XTYPE (valcontents) == Lisp_Objfwd)
+    forwarded_local_symbols = Fcons (sym, forwarded_local_symbols);
+}
+
 store_symval_forwarding (sym, valcontents, newval)
      Lisp_Object sym;
      register Lisp_Object valcontents, newval;
@@ -489,19 +565,26 @@ store_symval_forwarding (sym, valcontents, newval)
 
     case Lisp_Objfwd:
       *XOBJFWD (valcontents) = newval;
+      remember_store (sym, newval);
       break;
 
     case Lisp_Buffer_Objfwd:
-      *(Lisp_Object *)((int)XOBJFWD (valcontents) + (char *)bf_cur) = newval;
+      *(Lisp_Object *)((LISP_WORD) XOBJFWD (valcontents) + (char *)bf_cur) = newval;
       break;
 
     default:
       valcontents = XSYMBOL (sym)->value;
       if (XTYPE (valcontents) == Lisp_Buffer_Local_Value ||
 	  XTYPE (valcontents) == Lisp_Some_Buffer_Local_Value)
-	XCONS (XSYMBOL (sym)->value)->car = newval;
+	{
+	  XCONS (XSYMBOL (sym)->value)->car = newval;
+	  remember_cons (XSYMBOL (sym)->value);
+	}
       else
-	XSYMBOL (sym)->value = newval;
+	{
+	  XSYMBOL (sym)->value = newval;
+	  remember_store (sym, newval);
+	}
     }
 }
 
@@ -541,10 +624,11 @@ DEFUN ("symbol-value", Fsymbol_value, Ssymbol_value, 1, 1, 0, "Return SYMBOL's v
 	{
 	  tem1 = XCONS (XCONS (XCONS (valcontents)->cdr)->cdr)->car;
           Fsetcdr (tem1, do_symval_forwarding (XCONS (valcontents)->car));
-	  tem1 = Fassq (sym, bf_cur->local_var_alist);
+	  tem1 = buffer_local_cell (sym, bf_cur);
 	  if (NULL (tem1))
 	    tem1 = XCONS (XCONS (valcontents)->cdr)->cdr;
 	  XCONS (XCONS (XCONS (valcontents)->cdr)->cdr)->car = tem1;
+	  remember_cons (XCONS (XCONS (valcontents)->cdr)->cdr);
 	  XSET (XCONS (XCONS (valcontents)->cdr)->car, Lisp_Buffer, bf_cur);
 	  store_symval_forwarding (sym, XCONS (valcontents)->car, Fcdr (tem1));
 	}
@@ -564,7 +648,7 @@ DEFUN ("symbol-value", Fsymbol_value, Ssymbol_value, 1, 1, 0, "Return SYMBOL's v
       return *XOBJFWD (valcontents);
 
     case Lisp_Buffer_Objfwd:
-      return *(Lisp_Object *)((int)XOBJFWD (valcontents) + (char *)bf_cur);
+      return *(Lisp_Object *)((LISP_WORD) XOBJFWD (valcontents) + (char *)bf_cur);
 
     case Lisp_Symbol:
       /* For a symbol, check whether it is 'unbound. */
@@ -629,7 +713,7 @@ DEFUN ("set", Fset, Sset, 2, 2, 0,
 	{
           Fsetcdr (current_alist_element, do_symval_forwarding (XCONS (valcontents)->car));
 
-	  tem1 = Fassq (sym, bf_cur->local_var_alist);
+	  tem1 = buffer_local_cell (sym, bf_cur);
 	  if (NULL (tem1))
 	    /* This buffer sees the default value still.
 	       If type is Lisp_Some_Buffer_Local_Value, set the default value.
@@ -641,8 +725,10 @@ DEFUN ("set", Fset, Sset, 2, 2, 0,
 	      {
 		tem1 = Fcons (sym, Fcdr (current_alist_element));
 		bf_cur->local_var_alist = Fcons (tem1, bf_cur->local_var_alist);
+		set_buffer_local_cell (sym, bf_cur, tem1);
 	      }
 	  XCONS (XCONS (XCONS (valcontents)->cdr)->cdr)->car = tem1;
+	  remember_cons (XCONS (XCONS (valcontents)->cdr)->cdr);
 	  XSET (XCONS (XCONS (valcontents)->cdr)->car, Lisp_Buffer, bf_cur);
 	}
       valcontents = XCONS (valcontents)->car;
@@ -668,6 +754,7 @@ for this variable.")
 
   /* Store new value into the DEFAULT-VALUE slot */
   XCONS (XCONS (XCONS (valcontents)->cdr)->cdr)->cdr = value;
+  remember_cons (XCONS (XCONS (valcontents)->cdr)->cdr);
 
   /* If that slot is current, we must set the REALVALUE slot too */
   current_alist_element = XCONS (XCONS (XCONS (valcontents)->cdr)->cdr)->car;
@@ -705,10 +792,12 @@ for the current buffer if it was previously using the default value.")
     }
   if (EQ (valcontents, Qunbound))
     XSYMBOL (sym)->value = Qnil;
+  note_local_variable (sym, valcontents);
   tem = Fcons (Qnil, Fsymbol_value (sym));
   XCONS (tem)->car = tem;
   XSYMBOL (sym)->value = Fcons (XSYMBOL (sym)->value, Fcons (Fcurrent_buffer (), tem));
   XSETTYPE (XSYMBOL (sym)->value, Lisp_Buffer_Local_Value);
+  remember_store (sym, XSYMBOL (sym)->value);
   return sym;
 }
 
@@ -731,18 +820,20 @@ DEFUN ("make-local-variable", Fmake_local_variable, Smake_local_variable,
     {
       if (EQ (valcontents, Qunbound))
 	XSYMBOL (sym)->value = Qnil;
+      note_local_variable (sym, valcontents);
       tem = Fcons (Qnil, Fsymbol_value (sym));
       XCONS (tem)->car = tem;
       XSYMBOL (sym)->value = Fcons (XSYMBOL (sym)->value, Fcons (Qnil, tem));
       XSETTYPE (XSYMBOL (sym)->value, Lisp_Some_Buffer_Local_Value);
+      remember_store (sym, XSYMBOL (sym)->value);
     }
   /* Make sure this buffer has its own value of sym */
-  tem = Fassq (sym, bf_cur->local_var_alist);
+  tem = buffer_local_cell (sym, bf_cur);
   if (NULL (tem))
     {
-      bf_cur->local_var_alist
-        = Fcons (Fcons (sym, XCONS (XCONS (XCONS (XSYMBOL (sym)->value)->cdr)->cdr)->cdr),
-		 bf_cur->local_var_alist);
+      tem = Fcons (sym, XCONS (XCONS (XCONS (XSYMBOL (sym)->value)->cdr)->cdr)->cdr);
+      bf_cur->local_var_alist = Fcons (tem, bf_cur->local_var_alist);
+      set_buffer_local_cell (sym, bf_cur, tem);
       /* Make sure symbol does not think it is set up for this buffer;
 	 force it to look once again for this buffer's value */
       if (bf_cur == XBUFFER (XCONS (XCONS (XSYMBOL (sym)->value)->cdr)->car))
@@ -769,9 +860,12 @@ From now on the default value will apply in this buffer.")
 
   /* Get rid of this buffer's alist element, if any */
 
-  tem = Fassq (sym, bf_cur->local_var_alist);
+  tem = buffer_local_cell (sym, bf_cur);
   if (!NULL (tem))
-    bf_cur->local_var_alist = Fdelq (tem, bf_cur->local_var_alist);
+    {
+      bf_cur->local_var_alist = Fdelq (tem, bf_cur->local_var_alist);
+      set_buffer_local_cell (sym, bf_cur, Qnil);
+    }
 
   /* Put the symbol into a consistent state,
      set up for access in the current buffer with the default value */
@@ -830,7 +924,10 @@ ARRAY may be a vector or a string.  INDEX starts at 0.")
   CHECK_IMPURE (vector);
 
   if (XTYPE (vector) == Lisp_Vector)
-    XVECTOR (vector)->contents[idxval] = newelt;
+    {
+      XVECTOR (vector)->contents[idxval] = newelt;
+      remember_store (vector, newelt);
+    }
   else
     XSTRING (vector)->data[idxval] = XINT (newelt);
 
@@ -947,7 +1044,7 @@ DEFUN ("int-to-string", Fint_to_string, Sint_to_string, 1, 1, 0,
   char buffer[20];
 
   CHECK_NUMBER (num, 0);
-  sprintf (buffer, "%d", XINT (num));
+  sprintf (buffer, "%ld", (long) XINT (num));
   return build_string (buffer);
 }
 
@@ -1333,6 +1430,8 @@ syms_of_data ()
   staticpro (&Qerror_conditions);
   staticpro (&Qerror_message);
   staticpro (&Qtop_level);
+  forwarded_local_symbols = Qnil;
+  staticpro (&forwarded_local_symbols);
 
   staticpro (&Qerror);
   staticpro (&Qquit);
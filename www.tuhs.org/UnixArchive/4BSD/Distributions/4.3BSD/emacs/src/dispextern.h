@@ -34,6 +34,19 @@ extern int cursX, cursY;
 
 extern int display_completed;
 
+/* Size of the simulated screen, if virtual_terminal is nonzero. */
+
+extern int vt_width, vt_height;
+
+/* Redisplay budgets and statistics; see dispnew.c.  */
+
+extern int redisplay_time_budget;
+extern long redisplay_start_time;
+extern int redisplay_count;
+extern int redisplay_layout_preempts;
+extern int redisplay_output_preempts;
+extern long get_real_usecs ();
+
 /* Display line structure.
 This structure records the contents of a line
 either as already on the display
@@ -94,6 +94,41 @@ FILE *termscript;	/* Stdio stream being used for copy of all kbdinput.  */
 struct cm Wcm;		/* Structure for info on cursor positioning */
 
 extern short ospeed;	/* Output speed (from sg_ospeed) */
+
+/* Once a redisplay has run for redisplay_time_budget milliseconds,
+   it checks for input before laying out each window and before
+   outputting each line, and gives up as soon as input arrives.
+   Zero means check only when output is flushed.  */
+
+int redisplay_time_budget;
+
+/* Output is flushed and input checked for whenever
+   this many characters have been output since the last check.  */
+
+int redisplay_byte_budget;
+
+/* Value of get_real_usecs () when the current redisplay began.  */
+
+long redisplay_start_time;
+
+/* Number of redisplays, and how many of them were preempted
+   while laying out windows or while outputting.
+   These are reported by redisplay-statistics.  */
+
+int redisplay_count;
+int redisplay_layout_preempts;
+int redisplay_output_preempts;
+
+/* Return nonzero if the current redisplay has used up its time budget.  */
+
+redisplay_over_budget ()
+{
+  extern long get_real_usecs ();
+
+  return (redisplay_time_budget > 0
+	  && (get_real_usecs () - redisplay_start_time
+	      >= redisplay_time_budget * 1000));
+}
 
 /* Use these to chain together free lines */
 
@@ -177,7 +212,7 @@ return_display_line (p)
 {
   if (!p)
     return;
-  if ((int) LINE_NEXT (p) != 1)
+  if (LINE_NEXT (p) != (struct display_line *) 1)
     abort ();			/* Already free.  */
   SET_LINE_NEXT (p, free_display_lines);
   free_display_lines = p;
@@ -509,6 +544,40 @@ direct_output_forward_char (n)
 
 /* `force' nonzero means do not stop for pending input */
 
+/* Store into `order' the indices in PhysScreen of lines 1 through
+   screen_height - 1 in the order update_screen should do them, and
+   return how many there are: first the line the cursor is on, then
+   the rest of the selected window, then all the other lines.
+   Store in *nselected how many of them belong to the selected window;
+   update_screen does those even if input is pending, so that what
+   the user is looking at is always up to date.  */
+
+static int
+update_order (order, nselected)
+     register int *order;
+     int *nselected;
+{
+  register struct window *w = XWINDOW (selected_window);
+  register int i, n = 0;
+  int curs = cursY + 1;
+  int top = XFASTINT (w->top) + 1;
+  int bot = min (top + XFASTINT (w->height), screen_height);
+
+  if (curs >= 1 && curs < screen_height)
+    order[n++] = curs;
+  for (i = top; i < bot; i++)
+    if (i != curs)
+      order[n++] = i;
+  *nselected = n;
+  for (i = 1; i < top && i < screen_height; i++)
+    if (i != curs)
+      order[n++] = i;
+  for (i = max (bot, 1); i < screen_height; i++)
+    if (i != curs)
+      order[n++] = i;
+  return n;
+}
+
 /* Value is nonzero if redisplay stopped due to pending input */
 update_screen (force, inhibit_hairy_id)
      int force;
@@ -516,10 +585,12 @@ update_screen (force, inhibit_hairy_id)
 {
     register struct display_line **p;
     register struct display_line *l, *lnew;
-    register int i;
+    register int i, k;
     int pause;
     int preempt_count;
     int outq;
+    int *order = (int *) alloca (screen_height * sizeof (int));
+    int nlines, nselected;
     extern input_pending;
 
     if (screen_height == 0) abort (); /* Some bug zeros some core */
@@ -527,11 +598,6 @@ update_screen (force, inhibit_hairy_id)
     bcopy (PhysScreen, OPhysScreen, sizeof PhysScreen);
 
     detect_input_pending ();
-    if (input_pending && !force)
-      {
-	pause = 1;
-	goto do_pause;
-      }
 
     update_begin ();
 
@@ -541,18 +607,22 @@ update_screen (force, inhibit_hairy_id)
     /* Don't compute for i/d line if just want cursor motion. */
     for (p = &DesiredScreen[screen_height]; p != DesiredScreen && *p == 0; p--);
 
-    /* Try doing i/d line, if not yet inhibited.  */
-    if (!inhibit_hairy_id && p != DesiredScreen)
+    /* Try doing i/d line, if not yet inhibited.
+       Not worth it if input will stop us after the selected window.  */
+    if (!inhibit_hairy_id && p != DesiredScreen && (force || !input_pending))
       force |= scrolling ();
 
-    /* Update the individual lines as needed.  Do bottom line first.  */
+    /* Update the individual lines as needed.  Do bottom line first,
+       then the others in the order chosen by update_order.  */
 
     l = DesiredScreen[screen_height];
     if (l && l != PhysScreen[screen_height])
       update_line (PhysScreen[screen_height], l, screen_height - 1);
+    nlines = update_order (order, &nselected);
     preempt_count = baud_rate / 2400;
-    for (i = 1; i < screen_height && (force || !input_pending); i++)
+    for (k = 0; k < nlines && (force || k < nselected || !input_pending); k++)
       {
+	i = order[k];
 	l = PhysScreen[i];
 	lnew = DesiredScreen[i];
 	if (lnew && lnew != l)
@@ -560,9 +630,11 @@ update_screen (force, inhibit_hairy_id)
 	    /* Flush out every so many lines.
 	       Also flush out if likely to have more than 1k buffered otherwise.
 	       I'm told that telnet connections get really screwed by more
-	       than 1k output at once.  */
+	       than 1k output at once.
+	       Once over the time budget, flush and check every line.  */
 	    outq = stdout->_ptr - stdout->_base;
-	    if (outq > ((--preempt_count < 0) ? 20 : 900))
+	    if (outq > ((--preempt_count < 0) ? 20 : redisplay_byte_budget)
+		|| (!force && redisplay_over_budget ()))
 	      {
 		fflush (stdout);
 		if (baud_rate < 2400)
@@ -586,7 +658,7 @@ update_screen (force, inhibit_hairy_id)
 	    update_line (l, lnew, i - 1);
 	  }
       }
-    pause = (i < screen_height) ? i : 0;
+    pause = k < nlines;
 
     /* Now just clean up termcap drivers and set cursor, etc.  */
     if (!pause)
@@ -598,7 +670,6 @@ update_screen (force, inhibit_hairy_id)
       fflush (termscript);
     fflush (stdout);
 
-  do_pause:
     if (screen_height == 0) abort (); /* Some bug zeros some core */
     display_completed = !pause;
     /* Free any lines still in desired screen but not in phys screen */
@@ -772,7 +843,11 @@ update_line (old, new, vpos)
       if (nlen > nsp)
 	{
 	  topos (vpos, nsp);
+	  /* The line is blank on the screen, so write_chars
+	     need not output blanks in the middle of it.  */
+	  write_over_blanks = 1;
 	  write_chars (nbody + nsp, nlen - nsp);
+	  write_over_blanks = 0;
 	}
       return;
     }
@@ -1038,6 +1113,19 @@ Control characters in STRING will have terminal-dependent effects.")
   return Qnil;
 }
 
+DEFUN ("redisplay-statistics", Fredisplay_statistics, Sredisplay_statistics,
+  0, 0, 0,
+  "Return a list (REDISPLAYS LAYOUT-PREEMPTED OUTPUT-PREEMPTED).\n\
+REDISPLAYS is the number of redisplays done so far; the others say\n\
+how many of them gave up because of input, while laying out windows\n\
+or while updating the screen.  See redisplay-time-budget.")
+  ()
+{
+  return Fcons (make_number (redisplay_count),
+		Fcons (make_number (redisplay_layout_preempts),
+		       Fcons (make_number (redisplay_output_preempts), Qnil)));
+}
+
 DEFUN ("ding", Fding, Sding, 0, 0, 0,
   "Beep, or flash the screen.\n\
 Terminates any keyboard macro currently executing.")
@@ -1154,6 +1242,165 @@ DEFUN ("sit-for", Fsit_for, Ssit_for, 1, 1, 0,
   return Qnil;
 }
 
+/* Virtual terminal, for benchmarking redisplay (the -vt switch).
+   Redisplay runs normally, using the termcap entry vt_terminal_type,
+   but the screen size is vt_width by vt_height, terminal output goes
+   only into the termscript, and keystrokes are read from stdin
+   without ever preempting redisplay.  Each time a keystroke is read,
+   the CPU time and output bytes used since the previous one
+   (that is, by the last command and the redisplay after it)
+   are reported on stderr.  At end of input the final screen
+   is compared with the file vt_screen_name, or written there
+   if that file does not exist yet.  */
+
+char *vt_terminal_type;
+char *vt_termscript_name;
+char *vt_screen_name;
+int vt_width, vt_height;
+
+/* Number of keystrokes read so far, and totals of what they cost.  */
+static int vt_keys;
+static long vt_total_cpu, vt_total_bytes;
+
+/* CPU time and termscript position at the previous keystroke.  */
+static long vt_last_cpu, vt_last_bytes;
+
+init_virtual_terminal ()
+{
+  termscript = fopen (vt_termscript_name, "w");
+  if (!termscript)
+    {
+      fprintf (stderr, "emacs: cannot open %s\n", vt_termscript_name);
+      exit (1);
+    }
+  freopen ("/dev/null", "w", stdout);
+}
+
+/* Store into `buf' the text on screen line `vpos', without trailing
+   spaces, and return its length.  */
+
+static int
+vt_screen_line (vpos, buf)
+     int vpos;
+     char *buf;
+{
+  register struct display_line *l = PhysScreen[vpos + 1];
+  register int len = 0;
+
+  if (l)
+    {
+      len = l->length;
+      while (len > 0 && l->body[len - 1] == ' ')
+	len--;
+      bcopy (l->body, buf, len);
+    }
+  buf[len] = 0;
+  return len;
+}
+
+/* End of the keystroke script: check the final screen and exit.  */
+
+static
+vt_finish ()
+{
+  char line[MScreenWidth + 2], expected[MScreenWidth + 2];
+  register int vpos, len;
+  register FILE *f;
+  int mismatch = 0;
+
+  fprintf (stderr, "%5d keys %37ld %7ld\n", vt_keys, vt_total_cpu, vt_total_bytes);
+
+  f = fopen (vt_screen_name, "r");
+  if (f)
+    {
+      for (vpos = 0; vpos < screen_height && !mismatch; vpos++)
+	{
+	  vt_screen_line (vpos, line);
+	  if (!fgets (expected, sizeof expected, f))
+	    expected[0] = 0;
+	  len = strlen (expected);
+	  if (len > 0 && expected[len - 1] == '\n')
+	    expected[--len] = 0;
+	  if (strcmp (line, expected))
+	    {
+	      fprintf (stderr, "Screen line %d differs from %s:\n%s\n",
+		       vpos + 1, vt_screen_name, line);
+	      mismatch = 1;
+	    }
+	}
+      if (!mismatch && fgets (expected, sizeof expected, f))
+	{
+	  fprintf (stderr, "%s has more than %d lines\n",
+		   vt_screen_name, screen_height);
+	  mismatch = 1;
+	}
+    }
+  else
+    {
+      f = fopen (vt_screen_name, "w");
+      if (!f)
+	{
+	  fprintf (stderr, "emacs: cannot write %s\n", vt_screen_name);
+	  mismatch = 1;
+	}
+      else
+	for (vpos = 0; vpos < screen_height; vpos++)
+	  {
+	    vt_screen_line (vpos, line);
+	    fprintf (f, "%s\n", line);
+	  }
+    }
+  if (f)
+    fclose (f);
+  Fkill_emacs (make_number (mismatch));
+}
+
+/* Read the next keystroke for the virtual terminal,
+   first reporting the cost of the work done since the previous one.
+   Called from kbd_buffer_get_char.  */
+
+int
+vt_read_char ()
+{
+  register int c;
+  long cpu, bytes;
+  char keydesc[20];
+  extern long get_cpu_usecs ();
+  extern char *push_key_description ();
+  extern int last_input_char;
+  extern Lisp_Object this_command;
+
+  fflush (termscript);
+  cpu = get_cpu_usecs ();
+  bytes = ftell (termscript);
+
+  if (!vt_keys)
+    {
+      fprintf (stderr, "%5s %-8s %-28s %8s %7s\n",
+	       "key", "char", "command", "usecs", "bytes");
+      fprintf (stderr, "%5d %-8s %-28s %8ld %7ld\n",
+	       0, "", "startup", cpu, bytes);
+    }
+  else
+    {
+      *push_key_description (last_input_char, keydesc) = 0;
+      fprintf (stderr, "%5d %-8s %-28s %8ld %7ld\n", vt_keys, keydesc,
+	       (XTYPE (this_command) == Lisp_Symbol
+		? (char *) XSYMBOL (this_command)->name->data : "-"),
+	       cpu - vt_last_cpu, bytes - vt_last_bytes);
+      vt_total_cpu += cpu - vt_last_cpu;
+      vt_total_bytes += bytes - vt_last_bytes;
+    }
+  vt_last_cpu = cpu;
+  vt_last_bytes = bytes;
+
+  c = getchar ();
+  if (c < 0)
+    vt_finish ();
+  vt_keys++;
+  return c;
+}
+
 char *terminal_type;
 
 /* Initialization done when Emacs fork is started, before doing stty. */
@@ -1168,7 +1415,13 @@ init_display ()
 
   /* Look at the TERM variable and set terminal_driver.  */
 
-  terminal_type = (char *) getenv ("TERM");
+  if (virtual_terminal)
+    {
+      init_virtual_terminal ();
+      terminal_type = vt_terminal_type;
+    }
+  else
+    terminal_type = (char *) getenv ("TERM");
   if (!terminal_type)
     {
       fprintf (stderr, "Please set the environment variable TERM; see tset(1).\n");
@@ -1199,9 +1452,21 @@ syms_of_display ()
   defsubr (&Ssleep_for);
   defsubr (&Sbaud_rate);
   defsubr (&Ssend_string_to_terminal);
+  defsubr (&Sredisplay_statistics);
 
   DefBoolVar ("inverse-video", &inverse_video,
     "*Non-nil means use inverse-video.");
   DefBoolVar ("visible-bell", &visible_bell,
     "*Non-nil means try to flash the screen to represent a bell.");
+
+  DefIntVar ("redisplay-time-budget", &redisplay_time_budget,
+    "*Milliseconds a redisplay may run before it checks for input constantly.\n\
+After that long, it looks for input before each window and each line\n\
+and stops as soon as there is some.  Zero means look for input only\n\
+when output is flushed (see redisplay-output-budget).");
+  redisplay_time_budget = 0;
+
+  DefIntVar ("redisplay-output-budget", &redisplay_byte_budget,
+    "*Number of characters of output after which redisplay checks for input.");
+  redisplay_byte_budget = 900;
 }
@@ -25,65 +25,222 @@ and this notice must be preserved on all copies.  */
 #include "paths.h"
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/file.h>	/* Must be after sys/types.h for USG and BSD4_1*/
 
 #ifdef USG5
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifndef O_RDONLY
 #define O_RDONLY 0
 #endif
 
 Lisp_Object Vdoc_file_name;
 
-Lisp_Object
-get_doc_string (filepos)
-     long filepos;
+/* The doc string file is read once and kept in core, with an index
+ of the doc strings in it.  make-docfile puts the index at the end of
+ the file; for a file made without one, we make the index ourselves.
+ The file is read again only if it changes.  */
+
+static char *doc_name;		/* Name of file in core, or 0 */
+static char *doc_text;		/* Its text */
+static int doc_size;		/* Its size */
+static long doc_mtime;		/* Its modification time */
+static int doc_mapped;		/* Nonzero if text was mapped with mmap */
+
+struct doc_entry
+  {
+    char *name;			/* Name of function, in doc_text */
+    int namelen;
+    int pos;			/* Position of doc string */
+    int len;			/* Length of doc string */
+  };
+
+static struct doc_entry *doc_index;
+static int doc_nentries;
+
+/* Make the index of the doc strings in the text in core.  */
+
+static void
+index_doc_file ()
 {
-  char buf[512 * 32 + 1];
+  register char *p, *end, *tem;
+  register char *limit = doc_text + doc_size;
+  register struct doc_entry *e;
+  register int n;
+
+  /* An index made by make-docfile follows the last ^_, on its own line */
+  for (p = limit; p != doc_text && p[-1] != '\037'; p--);
+  if (p != doc_text && p != limit && *p == '\n')
+    {
+      end = p - 1;
+      for (n = 0, tem = p + 1; tem != limit; tem++)
+	if (*tem == '\n')
+	  n++;
+      doc_index = e = (struct doc_entry *) xmalloc ((n + 1) * sizeof *e);
+      for (p++; p != limit; p++)
+	{
+	  e->name = p;
+	  while (p != limit && *p != ' ' && *p != '\n')
+	    p++;
+	  e->namelen = p - e->name;
+	  for (e->pos = 0; p != limit && ++p != limit && *p >= '0' && *p <= '9';)
+	    e->pos = 10 * e->pos + *p - '0';
+	  for (e->len = 0; p != limit && ++p != limit && *p >= '0' && *p <= '9';)
+	    e->len = 10 * e->len + *p - '0';
+	  if (p == limit || *p != '\n'
+	      || e->pos + e->len > end - doc_text)
+	    break;
+	  e++;
+	}
+      doc_nentries = e - doc_index;
+      return;
+    }
+
+  /* No index; find the entries by their ^_'s */
+  for (n = 0, p = doc_text; p != limit; p++)
+    if (*p == '\037')
+      n++;
+  doc_index = e = (struct doc_entry *) xmalloc ((n + 1) * sizeof *e);
+  for (p = doc_text; p != limit && *p != '\037'; p++);
+  while (p != limit)
+    {
+      e->name = ++p;
+      while (p != limit && *p != '\n')
+	p++;
+      e->namelen = p - e->name;
+      if (p != limit)
+	p++;
+      e->pos = p - doc_text;
+      while (p != limit && *p != '\037')
+	p++;
+      e->len = p - doc_text - e->pos;
+      e++;
+    }
+  doc_nentries = e - doc_index;
+}
+
+/* Get the doc string file `name' in core, if it is not already.
+ Return 0 if successful, -1 if the file cannot be read.  */
+
+static int
+map_doc_file (name)
+     char *name;
+{
+  struct stat st;
   register int fd;
-  register char *name;
-  register char *p, *p1;
-  register int count;
-  extern char *index ();
 
-  if (XTYPE (Vexec_directory) != Lisp_String
-      || XTYPE (Vdoc_file_name) != Lisp_String)
-    return Qnil;
+  if (stat (name, &st) < 0)
+    return -1;
+  if (doc_name && !strcmp (doc_name, name)
+      && st.st_size == doc_size && st.st_mtime == doc_mtime)
+    return 0;
 
-  name = (char *) alloca (XSTRING (Vexec_directory)->size
-			  + XSTRING (Vdoc_file_name)->size + 2);
-  strcpy (name, XSTRING (Vexec_directory)->data);
-  strcat (name, XSTRING (Vdoc_file_name)->data);
+  if (doc_name)
+    {
+#ifdef HAVE_MMAP
+      if (doc_mapped)
+	munmap (doc_text, doc_size);
+      else
+#endif /* HAVE_MMAP */
+	free (doc_text);
+      free (doc_index);
+      free (doc_name);
+      doc_name = 0;
+    }
 
   fd = open (name, O_RDONLY, 0);
   if (fd < 0)
-    error ("Cannot open doc string file \"%s\"", name);
-  if (0 > lseek (fd, filepos, 0))
+    return -1;
+  if (fstat (fd, &st) < 0)
     {
       close (fd);
-      error ("Position %ld out of range in doc string file \"%s\"",
-	     filepos, name);
+      return -1;
+    }
+  doc_size = st.st_size;
+  doc_mtime = st.st_mtime;
+  doc_mapped = 0;
+#ifdef HAVE_MMAP
+  if (doc_size > 0)
+    {
+      doc_text = (char *) mmap (0, doc_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (doc_text != (char *) -1)
+	doc_mapped = 1;
     }
-  p = buf;
-  while (p != buf + sizeof buf - 1)
+#endif /* HAVE_MMAP */
+  if (!doc_mapped)
     {
-      count = read (fd, p, 512);
-      p[count] = 0;
-      if (!count)
-	break;
-      p1 = index (p, '\037');
-      if (p1)
+      doc_text = (char *) xmalloc (doc_size + 1);
+      if (read (fd, doc_text, doc_size) != doc_size)
 	{
-	  *p1 = 0;
-	  p = p1;
-	  break;
+	  free (doc_text);
+	  close (fd);
+	  return -1;
 	}
-      p += count;
     }
   close (fd);
-  return make_string (buf, p - buf);
+
+  index_doc_file ();
+  doc_name = (char *) xmalloc (strlen (name) + 1);
+  strcpy (doc_name, name);
+  return 0;
+}
+
+/* Get the doc string file named by exec-directory and
+ the file name recorded by Snarf-documentation in core.
+ Return zero if there is no such file name.  */
+
+static int
+open_doc_file ()
+{
+  register char *name;
+
+  if (XTYPE (Vexec_directory) != Lisp_String
+      || XTYPE (Vdoc_file_name) != Lisp_String)
+    return 0;
+
+  name = (char *) alloca (XSTRING (Vexec_directory)->size
+			  + XSTRING (Vdoc_file_name)->size + 2);
+  strcpy (name, XSTRING (Vexec_directory)->data);
+  strcat (name, XSTRING (Vdoc_file_name)->data);
+  if (map_doc_file (name) < 0)
+    error ("Cannot open doc string file \"%s\"", name);
+  return 1;
+}
+
+Lisp_Object
+get_doc_string (filepos)
+     long filepos;
+{
+  register int lo, hi, mid;
+  register char *p;
+
+  if (!open_doc_file ())
+    return Qnil;
+  if (filepos < 0 || filepos > doc_size)
+    error ("Position %ld out of range in doc string file \"%s\"",
+	   filepos, doc_name);
+
+  /* The index is in order of position */
+  lo = 0, hi = doc_nentries;
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (doc_index[mid].pos < filepos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  if (lo < doc_nentries && doc_index[lo].pos == filepos)
+    return make_string (doc_text + filepos, doc_index[lo].len);
+
+  for (p = doc_text + filepos; p != doc_text + doc_size && *p != '\037'; p++);
+  return make_string (doc_text + filepos, p - doc_text - filepos);
 }
 
 DEFUN ("documentation", Fdocumentation, Sdocumentation, 1, 1, 0,
@@ -101,9 +258,9 @@ DEFUN ("documentation", Fdocumentation, Sdocumentation, 1, 1, 0,
   if (XTYPE (fun) == Lisp_Subr)
     {
       if (XSUBR (fun)->doc == 0) return Qnil;
-      if ((int) XSUBR (fun)->doc >= 0)
+      if ((LISP_WORD) XSUBR (fun)->doc >= 0)
 	return Fsubstitute_command_keys (build_string (XSUBR (fun)->doc));
-      return Fsubstitute_command_keys (get_doc_string (- (int) XSUBR (fun)->doc));
+      return Fsubstitute_command_keys (get_doc_string ((long) - (LISP_WORD) XSUBR (fun)->doc));
     }
   if (XTYPE (fun) == Lisp_Vector)
     return build_string ("Prefix command (definition is a Lisp vector of subcommands).");
@@ -145,14 +302,10 @@ when doc strings are referred to later in the dumped Emacs.")
   (filename)
      Lisp_Object filename;
 {
-  int fd;
-  char buf[1024 + 1];
-  register int filled;
+  register struct doc_entry *e;
   register int pos;
-  register char *p, *end;
   Lisp_Object sym, fun, tem;
   char *name;
-  extern char *index ();
 
   CHECK_STRING (filename, 0);
 
@@ -166,52 +319,58 @@ when doc strings are referred to later in the dumped Emacs.")
 #endif /* CANNOT_DUMP */
   strcat (name, XSTRING (filename)->data); 	/*** Add this line ***/
 
-  fd = open (name, O_RDONLY, 0);
-  if (fd < 0)
+  if (map_doc_file (name) < 0)
     report_file_error ("Opening doc string file", Fcons (filename, Qnil));
   Vdoc_file_name = filename;
-  filled = 0;
-  pos = 0;
-  while (1)
+  for (e = doc_index; e != doc_index + doc_nentries; e++)
     {
-      if (filled < 512)
-	filled += read (fd, &buf[filled], sizeof buf - 1 - filled);
-      if (!filled)
-	break;
-
-      buf[filled] = 0;
-      p = buf;
-      end = buf + (filled < 512 ? filled : filled - 128);
-      while (p != end && *p != '\037') p++;
-      if (p != end)
+      sym = oblookup (Vobarray, e->name, e->namelen);
+      if (XTYPE (sym) != Lisp_Symbol)
+	continue;
+      pos = e->pos;
+      fun = XSYMBOL (sym)->function;
+      if (XTYPE (fun) == Lisp_Subr)
+	XSUBR (fun)->doc = (char *) - (LISP_WORD) pos;
+      else if (LISTP (fun))
 	{
-	  end = index (p, '\n');
-	  sym = oblookup (Vobarray, p + 1, end - p - 1);
-	  if (XTYPE (sym) == Lisp_Symbol)
+	  tem = XCONS (fun)->car;
+	  if (EQ (tem, Qlambda) || EQ (tem, Qautoload))
 	    {
-	      fun = XSYMBOL (sym)->function;
-	      if (XTYPE (fun) == Lisp_Subr)
-		XSUBR (fun)->doc = (char *) - (pos + end + 1 - buf);
-	      else if (LISTP (fun))
-		{
-		  tem = XCONS (fun)->car;
-		  if (EQ (tem, Qlambda) || EQ (tem, Qautoload))
-		    {
-		      tem = Fcdr (Fcdr (fun));
-		      if (LISTP (tem) && XTYPE (XCONS (tem)->car) == Lisp_Int)
-			XFASTINT (XCONS (tem)->car) = (pos + end + 1 - buf);
-		    }
-		}
+	      tem = Fcdr (Fcdr (fun));
+	      if (LISTP (tem) && XTYPE (XCONS (tem)->car) == Lisp_Int)
+		XFASTINT (XCONS (tem)->car) = pos;
 	    }
 	}
-      pos += end - buf;
-      filled -= end - buf;
-      bcopy (end, buf, filled);
     }
-  close (fd);
   return Qnil;
 }
 
+DEFUN ("apropos-documentation", Fapropos_documentation,
+  Sapropos_documentation, 1, 1, 0,
+  "Return a list of the functions whose documentation matches REGEXP.\n\
+Only documentation in the doc string file is searched.  It is searched\n\
+where it lies, without making a string of each doc string.")
+  (regexp)
+     Lisp_Object regexp;
+{
+  register struct doc_entry *e;
+  Lisp_Object sym, val;
+
+  CHECK_STRING (regexp, 0);
+  if (!open_doc_file ())
+    return Qnil;
+
+  val = Qnil;
+  for (e = doc_index; e != doc_index + doc_nentries; e++)
+    if (search_chars (regexp, doc_text + e->pos, e->len))
+      {
+	sym = oblookup (Vobarray, e->name, e->namelen);
+	if (XTYPE (sym) == Lisp_Symbol)
+	  val = Fcons (sym, val);
+      }
+  return Fnreverse (val);
+}
+
 extern Lisp_Object where_is_in_buffer ();
 
 DEFUN ("substitute-command-keys", Fsubstitute_command_keys,
@@ -347,5 +506,6 @@ syms_of_doc ()
 
   defsubr (&Sdocumentation);
   defsubr (&Ssnarf_documentation);
+  defsubr (&Sapropos_documentation);
   defsubr (&Ssubstitute_command_keys);
 }
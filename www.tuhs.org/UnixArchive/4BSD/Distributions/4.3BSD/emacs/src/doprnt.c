@@ -93,7 +93,7 @@ doprnt (buffer, bufsize, format, args)
 	      continue;
 
 	    case 'c':
-	      *bufptr++ = (int) args[cnt++];
+	      *bufptr++ = (long) args[cnt++];
 	      bufsize--;
 	      continue;
 
@@ -46,6 +46,7 @@ init_editfns ()
   int first;
   struct passwd *pw;	/* password entry for the current user */
   extern char *index ();
+  extern char *get_system_name ();
 
   /* Don't bother with this on initial start when just dumping out */
   if (!NULL (Vpurify_flag))
@@ -104,7 +105,7 @@ init_editfns ()
   *q = 0;
 #endif /* AMPERSAND_FULL_NAME */
 
-  p = (char *) get_system_name ();
+  p = get_system_name ();
   if (p == 0 || *p == 0)
     p = "Bogus System Name";
   strncpy (system_name, p, sizeof system_name);
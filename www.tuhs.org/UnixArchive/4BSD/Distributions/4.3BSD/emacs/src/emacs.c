@@ -64,6 +64,11 @@ int noninteractive;
    but nothing terrible happens if user sets this one.  */
 
 int noninteractive1;
+
+/* Nonzero means display on a simulated terminal instead of a real one.
+   Set by the -vt switch; see vt_read_char in dispnew.c.  */
+
+int virtual_terminal;
 
 /* Signal code for the fatal signal that was received */
 int fatal_error_code;
@@ -133,6 +138,83 @@ init_cmdargs (argc, argv, skip_args)
     }
 }
 
+/* Intern the names of all standard functions and variables; define standard keys */
+
+static
+init_lisp_symbols ()
+{
+  /* The basic levels of Lisp must come first */
+  /* And data must come first of all
+     for the sake of symbols like error-message */
+  syms_of_data ();
+  syms_of_alloc ();
+  syms_of_read ();
+  syms_of_print ();
+  syms_of_eval ();
+  syms_of_fns ();
+
+  syms_of_abbrev ();
+  syms_of_buffer ();
+  syms_of_bytecode ();
+  syms_of_callint ();
+  syms_of_casefiddle ();
+  syms_of_callproc ();
+  syms_of_cmds ();
+#ifndef NO_DIR_LIBRARY
+  syms_of_dired ();
+#endif /* not NO_DIR_LIBRARY */
+  syms_of_display ();
+  syms_of_doc ();
+  syms_of_editfns ();
+  syms_of_emacs ();
+  syms_of_fileio ();
+#ifdef CLASH_DETECTION
+  syms_of_filelock ();
+#endif /* CLASH_DETECTION */
+  syms_of_indent ();
+  syms_of_keyboard ();
+  syms_of_keymap ();
+  syms_of_macros ();
+  syms_of_marker ();
+  syms_of_minibuf ();
+  syms_of_mocklisp ();
+  syms_of_pdump ();
+#ifdef subprocesses
+  syms_of_process ();
+#endif /* subprocesses */
+  syms_of_search ();
+  syms_of_syntax ();
+  syms_of_undo ();
+  syms_of_window ();
+  syms_of_xdisp ();
+#ifdef HAVE_X_WINDOWS
+  syms_of_xfns ();
+#endif /* HAVE_X_WINDOWS */
+
+  keys_of_casefiddle ();
+  keys_of_cmds ();
+  keys_of_buffer ();
+  keys_of_keyboard ();
+  keys_of_keymap ();
+  keys_of_macros ();
+  keys_of_minibuf ();
+  keys_of_window ();
+}
+
+/* If `msg' is nonzero, report that loading the portable dump
+   file `file' failed for that reason, and exit.  */
+
+static
+dump_file_error (file, msg)
+     char *file, *msg;
+{
+  if (msg)
+    {
+      fprintf (stderr, "emacs: %s: %s\n", file, msg);
+      exit (1);
+    }
+}
+
 /* ARGSUSED */
 main (argc, argv, envp)
      int argc;
@@ -140,6 +222,8 @@ main (argc, argv, envp)
      char **envp;
 {
   int skip_args = 0;
+  char *dump_file = 0;
+  extern char *map_portable_dump (), *load_portable_dump ();
   extern int errno;
   clearerr (stdin);
 
@@ -170,6 +254,19 @@ main (argc, argv, envp)
   setuid(getuid());
 #endif HIGHPRI
 
+/* Handle the -pdump switch, which specifies a file made by
+   dump-emacs-portable to load the Lisp state from.
+   Remove it, so that the other switches are seen as usual.  */
+  if (2 < argc && !strcmp (argv[1], "-pdump"))
+    {
+      register int i;
+
+      dump_file = argv[2];
+      for (i = 3; i <= argc; i++)
+	argv[i - 2] = argv[i];
+      argc -= 2;
+    }
+
 /* Handle the -t switch, which specifies filename to use as terminal */
   if (2 < argc && !strcmp (argv[1], "-t"))
     {
@@ -191,11 +288,43 @@ main (argc, argv, envp)
 
   noninteractive1 = noninteractive;
 
+/* Handle the -vt switch, which means redisplay on a virtual terminal
+   for benchmarking.  It takes four arguments: the terminal type,
+   the screen size as COLSxLINES, a file to receive all terminal output
+   and a file holding the expected final screen contents.
+   Keystrokes are read from stdin; statistics go to stderr.  */
+  virtual_terminal = 0;
+  if (5 < argc && !strcmp (argv[1], "-vt"))
+    {
+      extern char *vt_terminal_type, *vt_termscript_name, *vt_screen_name;
+      extern int vt_width, vt_height;
+
+      skip_args = 5;
+      virtual_terminal = 1;
+      vt_terminal_type = argv[2];
+      if (sscanf (argv[3], "%dx%d", &vt_width, &vt_height) != 2
+	  || vt_width <= 0 || vt_height <= 2)
+	{
+	  fprintf (stderr, "emacs: bad virtual screen size %s\n", argv[3]);
+	  exit (1);
+	}
+      /* The display lines and the buffers that hold them
+	 are only MScreenWidth wide.  */
+      if (vt_width > MScreenWidth)
+	vt_width = MScreenWidth;
+      if (vt_height > MScreenLength)
+	vt_height = MScreenLength;
+      vt_termscript_name = argv[4];
+      vt_screen_name = argv[5];
+    }
+
 /* Perform basic initializations (not merely interning symbols) */
 
   if (!initialized)
     {
       init_alloc_once ();
+      if (dump_file)		/* Must precede any use of pure storage */
+	dump_file_error (dump_file, map_portable_dump (dump_file));
       init_obarray ();
       init_eval_once ();
       init_syntax_once ();	/* Create standard syntax table.  */
@@ -206,6 +335,17 @@ main (argc, argv, envp)
       init_window_once ();	/* Init the window system */
     }
 
+/* Restore the Lisp state from a portable dump.  This takes the place
+   of loading loadup.el, and is done before the initializations below
+   just as an unexec'd Emacs has its state before it runs them.  */
+
+  if (!initialized && dump_file)
+    {
+      init_lisp_symbols ();
+      dump_file_error (dump_file, load_portable_dump ());
+      initialized = 1;
+    }
+
   init_alloc ();
   init_eval ();
   init_data ();
@@ -225,66 +365,8 @@ main (argc, argv, envp)
   init_process ();
 #endif subprocesses
 
-/* Intern the names of all standard functions and variables; define standard keys */
-
   if (!initialized)
-    {
-      /* The basic levels of Lisp must come first */
-      /* And data must come first of all
-	 for the sake of symbols like error-message */
-      syms_of_data ();
-      syms_of_alloc ();
-      syms_of_read ();
-      syms_of_print ();
-      syms_of_eval ();
-      syms_of_fns ();
-
-      syms_of_abbrev ();
-      syms_of_buffer ();
-      syms_of_bytecode ();
-      syms_of_callint ();
-      syms_of_casefiddle ();
-      syms_of_callproc ();
-      syms_of_cmds ();
-#ifndef NO_DIR_LIBRARY
-      syms_of_dired ();
-#endif /* not NO_DIR_LIBRARY */
-      syms_of_display ();
-      syms_of_doc ();
-      syms_of_editfns ();
-      syms_of_emacs ();
-      syms_of_fileio ();
-#ifdef CLASH_DETECTION
-      syms_of_filelock ();
-#endif /* CLASH_DETECTION */
-      syms_of_indent ();
-      syms_of_keyboard ();
-      syms_of_keymap ();
-      syms_of_macros ();
-      syms_of_marker ();
-      syms_of_minibuf ();
-      syms_of_mocklisp ();
-#ifdef subprocesses
-      syms_of_process ();
-#endif /* subprocesses */
-      syms_of_search ();
-      syms_of_syntax ();
-      syms_of_undo ();
-      syms_of_window ();
-      syms_of_xdisp ();
-#ifdef HAVE_X_WINDOWS
-      syms_of_xfns ();
-#endif /* HAVE_X_WINDOWS */
-
-      keys_of_casefiddle ();
-      keys_of_cmds ();
-      keys_of_buffer ();
-      keys_of_keyboard ();
-      keys_of_keymap ();
-      keys_of_macros ();
-      keys_of_minibuf ();
-      keys_of_window ();
-    }
+    init_lisp_symbols ();
 
   if (!initialized)
     {
@@ -317,7 +399,7 @@ return ARG as the exit program code.")
   Lisp_Object answer;
   int i;
 
-  if (feof (stdin))
+  if (feof (stdin) && NULL (arg))
     arg = Qt;
   if (!noninteractive && NULL (arg))
     {
@@ -30,6 +30,29 @@ and this notice must be preserved on all copies.  */
 
 #include <setjmp.h>
 
+#ifdef HAVE_TIMEVAL
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#ifndef MAP_ANON
+#define MAP_ANON MAP_ANONYMOUS
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+/* Number of specbindings to reserve address space for.
+ The binding stack grows within this space without being moved.  */
+#ifndef SPECPDL_RESERVE
+#define SPECPDL_RESERVE (1 << 18)
+#endif
+#endif /* HAVE_MMAP */
+
 /* This definition is duplicated in alloc.c and keyboard.c */
 /* Putting it in lisp.h makes cc bomb out! */
 
@@ -87,6 +110,13 @@ struct specbinding *specpdl_ptr;
 
 int max_specpdl_size;
 
+#ifdef HAVE_MMAP
+/* Nonzero if specpdl is address space reserved for SPECPDL_RESERVE
+   bindings, rather than memory from malloc.  */
+
+static int specpdl_in_place;
+#endif /* HAVE_MMAP */
+
 /* Depth in Lisp evaluations and function calls.  */
 
 int lisp_eval_depth;
@@ -95,6 +125,101 @@ int lisp_eval_depth;
 
 int max_lisp_eval_depth;
 
+/* Incremented whenever a function definition may have changed,
+ and by each garbage collection.  Any call cache entry made before
+ the latest increment is out of date.  */
+
+int function_generation;
+
+/* A cache of the functions called from recently used call sites.
+ A call site is an interpreted form or a call in some byte code.
+ An entry records the symbol called there, the function definition
+ it was found to have and which kind of function that was, so that
+ the next call from the same site can go straight to the function.
+ The kind of a lambda or macro is checked again on each use.  */
+
+#define CALL_CACHE_SIZE 512	/* Must be a power of 2 */
+
+#define CALL_SUBR 1
+#define CALL_LAMBDA 2
+#define CALL_MACRO 3
+
+struct call_cache
+  {
+    LISP_WORD site;		/* Address of the call site */
+    Lisp_Object name;		/* Symbol called there */
+    Lisp_Object fun;		/* Its function definition */
+    int kind;			/* CALL_SUBR, CALL_LAMBDA or CALL_MACRO */
+    int generation;		/* function_generation when entry made */
+  };
+
+static struct call_cache call_cache[CALL_CACHE_SIZE];
+
+#define CALL_CACHE_ENTRY(site) \
+  (&call_cache[((site) >> 3) & (CALL_CACHE_SIZE - 1)])
+
+/* Return the function definition of `name', which is called from
+ the call site at address `site', following symbols' function cells
+ as far as they go.  Store in *kindptr what kind of function it is,
+ or 0 for one that must be checked in detail.  */
+
+static Lisp_Object
+call_site_function (site, name, kindptr)
+     LISP_WORD site;
+     Lisp_Object name;
+     int *kindptr;
+{
+  register struct call_cache *cache = CALL_CACHE_ENTRY (site);
+  register Lisp_Object fun, val, funcar;
+  register int kind = 0;
+
+  /* fset changes function_generation, but a lambda or macro can also
+     be changed in place, so look at its car again.  */
+  if (cache->site == site && EQ (cache->name, name)
+      && cache->generation == function_generation
+      && (cache->kind == CALL_SUBR
+	  || EQ (XCONS (cache->fun)->car,
+		 cache->kind == CALL_LAMBDA ? Qlambda : Qmacro)))
+    {
+      *kindptr = cache->kind;
+      return cache->fun;
+    }
+
+  fun = name;
+  while (XTYPE (fun) == Lisp_Symbol)
+    {
+      val = XSYMBOL (fun)->function;
+      if (EQ (val, Qunbound))
+	Fsymbol_function (fun);	/* Get the right kind of error! */
+      fun = val;
+    }
+
+  if (XTYPE (fun) == Lisp_Subr)
+    kind = CALL_SUBR;
+  else if (XTYPE (fun) == Lisp_Cons)
+    {
+      funcar = XCONS (fun)->car;
+      if (EQ (funcar, Qlambda))
+	kind = CALL_LAMBDA;
+      else if (EQ (funcar, Qmacro))
+	kind = CALL_MACRO;
+    }
+
+  /* Only a call by a symbol's name is worth remembering; the same
+     site may call another function only after that symbol's
+     function definition changes.  */
+  if (kind && site && XTYPE (name) == Lisp_Symbol)
+    {
+      cache->site = site;
+      cache->name = name;
+      cache->fun = fun;
+      cache->kind = kind;
+      cache->generation = function_generation;
+    }
+  *kindptr = kind;
+  return fun;
+}
+
 /* Nonzero means enter debugger before next function call */
 int debug_on_next_call;
 
@@ -120,7 +245,19 @@ extern Lisp_Object ml_apply (); /* Apply a mocklisp function to unevaluated argu
 init_eval_once ()
 {
   specpdl_size = 100;
+#ifdef HAVE_MMAP
+  /* Pages of the reservation are supplied by the system
+     only as the bindings in them are first used.  */
+  specpdl = (struct specbinding *) mmap (0, SPECPDL_RESERVE * sizeof (struct specbinding),
+					 PROT_READ | PROT_WRITE,
+					 MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+  if (specpdl == (struct specbinding *) -1)
+    specpdl = (struct specbinding *) malloc (specpdl_size * sizeof (struct specbinding));
+  else
+    specpdl_in_place = 1;
+#else
   specpdl = (struct specbinding *) malloc (specpdl_size * sizeof (struct specbinding));
+#endif /* HAVE_MMAP */
   max_specpdl_size = 600;
   max_lisp_eval_depth = 200;
 }
@@ -1245,6 +1382,7 @@ DEFUN ("eval", Feval, Seval, 1, 1, 0,
 {
   Lisp_Object fun, val, original_fun, original_args;
   Lisp_Object funcar;
+  int kind;
   struct backtrace backtrace;
   struct gcpro gcpro1, gcpro2, gcpro3;
 
@@ -1263,10 +1401,10 @@ DEFUN ("eval", Feval, Seval, 1, 1, 0,
     return form;
 
   QUIT;
-  if (consing_since_gc > gc_cons_threshold)
+  if (consing_since_gc > gc_trigger)
     {
       GCPRO1 (form);
-      Fgarbage_collect ();
+      collect_garbage ();
       UNGCPRO;
     }
 
@@ -1282,12 +1420,14 @@ DEFUN ("eval", Feval, Seval, 1, 1, 0,
   original_args = Fcdr (form);
 
   backtrace.next = backtrace_list;
-  backtrace_list = &backtrace;
   backtrace.function = &original_fun; /* This also protects them from gc */
   backtrace.args = &original_args;
   backtrace.nargs = UNEVALLED;
   backtrace.evalargs = 1;
   backtrace.debug_on_exit = 0;
+  /* Link the frame in only when it is complete,
+     since the Lisp profiler may look at it any time.  */
+  backtrace_list = &backtrace;
 
   if (debug_on_next_call)
     do_debug_on_call (Qt);
@@ -1295,16 +1435,15 @@ DEFUN ("eval", Feval, Seval, 1, 1, 0,
   /* At this point, only original_fun and original_args
      have values that will be used below */
  retry:
-  fun = original_fun;
-  while (XTYPE (fun) == Lisp_Symbol)
+  fun = call_site_function ((LISP_WORD) XCONS (form), original_fun, &kind);
+
+  if (kind == CALL_LAMBDA)
     {
-      val = XSYMBOL (fun)->function;
-      if (EQ (val, Qunbound))
-	Fsymbol_function (fun);	/* Get the right kind of error! */
-      fun = val;
+      val = apply_lambda (fun, original_args, 1);
+      goto done;
     }
 
-  if (XTYPE (fun) == Lisp_Subr)
+  if (kind == CALL_SUBR)
     {
       Lisp_Object numargs;
       Lisp_Object argvals[5];
@@ -1389,6 +1528,11 @@ DEFUN ("eval", Feval, Seval, 1, 1, 0,
 	  goto done;
 	}
     }
+  if (kind == CALL_MACRO)
+    {
+      val = Feval (Fapply (XCONS (fun)->cdr, original_args));
+      goto done;
+    }
   if (!LISTP(fun))
     return Fsignal (Qinvalid_function, Fcons (fun, Qnil));
   funcar = Fcar (fun);
@@ -1399,11 +1543,7 @@ DEFUN ("eval", Feval, Seval, 1, 1, 0,
       do_autoload (fun, original_fun);
       goto retry;
     }
-  if (EQ (funcar, Qmacro))
-    val = Feval (Fapply (Fcdr (fun), original_args));
-  else if (EQ (funcar, Qlambda))
-    val = apply_lambda (fun, original_args, 1);
-  else if (EQ (funcar, Qmocklisp))
+  if (EQ (funcar, Qmocklisp))
     val = ml_apply (fun, original_args);
   else
     return Fsignal (Qinvalid_function, Fcons (fun, Qnil));
@@ -1435,10 +1575,10 @@ DEFUN ("apply", Fapply, Sapply, 2, 2, 0,
   struct gcpro gcpro1, gcpro2;
 
   QUIT;
-  if (consing_since_gc > gc_cons_threshold)
+  if (consing_since_gc > gc_trigger)
     {
       GCPRO2 (original_fun, original_args);
-      Fgarbage_collect ();
+      collect_garbage ();
       UNGCPRO;
     }
 
@@ -1451,12 +1591,12 @@ DEFUN ("apply", Fapply, Sapply, 2, 2, 0,
     }
 
   backtrace.next = backtrace_list;
-  backtrace_list = &backtrace;
   backtrace.function = &original_fun; /* This also protects them */
   backtrace.args = &original_args; /* from gc */
   backtrace.nargs = MANY;
   backtrace.evalargs = 0;
   backtrace.debug_on_exit = 0;
+  backtrace_list = &backtrace;
 
   if (debug_on_next_call)
     do_debug_on_call (Qlambda);
@@ -1626,9 +1766,22 @@ Thus,  (funcall 'cons 'x 'y)  returns  (x . y).")
   (nargs, args)
      int nargs;
      Lisp_Object *args;
+{
+  return funcall_from ((LISP_WORD) 0, nargs, args);
+}
+
+/* Like Ffuncall, for a call from the call site at address `site'.
+ Zero for `site' means the call is from no particular place.  */
+
+Lisp_Object
+funcall_from (site, nargs, args)
+     LISP_WORD site;
+     int nargs;
+     Lisp_Object *args;
 {
   Lisp_Object fun;
   Lisp_Object funcar;
+  int kind;
   int numargs = nargs - 1;
   Lisp_Object lisp_numargs;
   Lisp_Object val;
@@ -1638,11 +1791,11 @@ Thus,  (funcall 'cons 'x 'y)  returns  (x . y).")
   register int i;
 
   QUIT;
-  if (consing_since_gc > gc_cons_threshold)
+  if (consing_since_gc > gc_trigger)
     {
       GCPRO1 (*args);
       gcpro1.nvars = nargs;
-      Fgarbage_collect ();
+      collect_garbage ();
       UNGCPRO;
     }
 
@@ -1655,28 +1808,27 @@ Thus,  (funcall 'cons 'x 'y)  returns  (x . y).")
     }
 
   backtrace.next = backtrace_list;
-  backtrace_list = &backtrace;
   backtrace.function = &args[0];
   backtrace.args = &args[1];
   backtrace.nargs = nargs - 1;
   backtrace.evalargs = 0;
   backtrace.debug_on_exit = 0;
+  backtrace_list = &backtrace;
 
   if (debug_on_next_call)
     do_debug_on_call (Qlambda);
 
  retry:
 
-  fun = args[0];
-  while (XTYPE (fun) == Lisp_Symbol)
+  fun = call_site_function (site, args[0], &kind);
+
+  if (kind == CALL_LAMBDA)
     {
-      val = XSYMBOL (fun)->function;
-      if (EQ (val, Qunbound))
-	Fsymbol_function (fun);	/* Get the right kind of error! */
-      fun = val;
+      val = funcall_lambda (fun, numargs, args + 1);
+      goto done;
     }
 
-  if (XTYPE (fun) == Lisp_Subr)
+  if (kind == CALL_SUBR)
     {
       if (numargs < XSUBR (fun)->min_args ||
 	  (XSUBR (fun)->max_args >= 0 && XSUBR (fun)->max_args < numargs))
@@ -1868,18 +2020,58 @@ grow_specpdl ()
   specpdl_size *= 2;
   if (specpdl_size > max_specpdl_size)
     specpdl_size = max_specpdl_size;
+#ifdef HAVE_MMAP
+  /* When the stack lives in reserved address space,
+     growing it only moves the limit; nothing is copied.  */
+  if (specpdl_in_place)
+    {
+      if (specpdl_size > SPECPDL_RESERVE)
+	{
+	  specpdl_size = SPECPDL_RESERVE;
+	  if (specpdl_ptr == specpdl + specpdl_size)
+	    Fsignal (Qerror,
+		     build_string ("Variable binding depth exceeds max-specpdl-size"));
+	}
+      return;
+    }
+#endif /* HAVE_MMAP */
   specpdl = (struct specbinding *) xrealloc (specpdl, specpdl_size * sizeof (struct specbinding));
   specpdl_ptr += specpdl - old;
 }
 
+/* Nonzero if VALCONTENTS, the contents of a symbol's value cell,
+ is simply the symbol's value (or Qunbound), so that a binding
+ can save and store it directly without going through Fset.  */
+
+#define PLAIN_VALUE_P(valcontents) \
+  (XTYPE (valcontents) != Lisp_Intfwd \
+   && XTYPE (valcontents) != Lisp_Boolfwd \
+   && XTYPE (valcontents) != Lisp_Objfwd \
+   && XTYPE (valcontents) != Lisp_Buffer_Objfwd \
+   && XTYPE (valcontents) != Lisp_Buffer_Local_Value \
+   && XTYPE (valcontents) != Lisp_Some_Buffer_Local_Value \
+   && XTYPE (valcontents) != Lisp_Void)
+
 void
 specbind (symbol, value)
      Lisp_Object symbol, value;
 {
+  register Lisp_Object valcontents;
+
   if (specpdl_ptr == specpdl + specpdl_size)
     grow_specpdl ();
   specpdl_ptr->symbol = symbol;
-  specpdl_ptr->old_value = EQ (XSYMBOL (symbol)->value, Qunbound) ? Qunbound : Fsymbol_value (symbol);
+  valcontents = XSYMBOL (symbol)->value;
+  /* Most bindings are of ordinary variables, such as function arguments.  */
+  if (PLAIN_VALUE_P (valcontents) && !NULL (symbol) && !EQ (symbol, Qt))
+    {
+      specpdl_ptr->old_value = valcontents;
+      specpdl_ptr++;
+      XSYMBOL (symbol)->value = value;
+      remember_store (symbol, value);
+      return;
+    }
+  specpdl_ptr->old_value = EQ (valcontents, Qunbound) ? Qunbound : Fsymbol_value (symbol);
   specpdl_ptr++;
   Fset (symbol, value);
 }
@@ -1918,6 +2110,12 @@ unbind_to (count)
 	This is used when C code makes an unwind-protect.  */
       else if (XTYPE (specpdl_ptr->symbol) == Lisp_Internal_Function)
 	(*XFUNCTION (specpdl_ptr->symbol)) (specpdl_ptr->old_value);
+      else if (PLAIN_VALUE_P (XSYMBOL (specpdl_ptr->symbol)->value)
+	       && !EQ (specpdl_ptr->symbol, Qt))
+	{
+	  XSYMBOL (specpdl_ptr->symbol)->value = specpdl_ptr->old_value;
+	  remember_store (specpdl_ptr->symbol, specpdl_ptr->old_value);
+	}
       else
         Fset (specpdl_ptr->symbol, specpdl_ptr->old_value);
     }
@@ -2034,6 +2232,387 @@ Output stream used is value of standard-output.")
   return Qnil;
 }
 
+/* The Lisp profiler.
+
+ While it runs, an interval timer interrupts Emacs every so often,
+ and each interrupt adds the Lisp functions being called, as found in
+ backtrace_list, to a tree of calls.  Each node of the tree stands for
+ a function called from its parent node's function.  It counts the
+ samples taken while that call was in progress, and how many of those
+ found the call innermost.  The nodes are allocated in advance,
+ since the interrupt must not allocate anything.  */
+
+struct profile_node
+  {
+    Lisp_Object fun;		/* Function called */
+    int total;			/* Samples during the call */
+    int self;			/* Samples with the call innermost */
+    struct profile_node *children;	/* Calls it made */
+    struct profile_node *next;	/* Next call its parent made */
+  };
+
+#define PROFILE_NODES 10000	/* Nodes in the tree, at most */
+#define PROFILE_DEPTH 200	/* Calls recorded in a sample, at most */
+
+/* The root of the tree comes first, and stands for no call */
+static struct profile_node *profile_nodes;
+static int profile_nodes_used;
+
+static int lisp_profiling;
+static int profile_interval;	/* Milliseconds between samples */
+static int profile_gc_samples;	/* Samples taken during garbage collection */
+static int profile_lost_samples;	/* Samples that ran out of nodes */
+
+/* Take a sample of backtrace_list.  This is the timer's signal handler.  */
+
+static
+profile_signal ()
+{
+  struct profile_node *path[PROFILE_DEPTH];
+  struct backtrace *stack[PROFILE_DEPTH];
+  register struct backtrace *backlist;
+  register struct profile_node *node, *child;
+  register int depth, i;
+  register Lisp_Object fun;
+  extern int gc_in_progress;
+
+#if defined (USG) && defined (ITIMER_PROF)
+  signal (SIGPROF, profile_signal);
+#endif
+  if (!lisp_profiling)
+    return;
+  /* The functions in backtrace_list may be moving just now */
+  if (gc_in_progress)
+    {
+      profile_gc_samples++;
+      return;
+    }
+
+  /* Only the outermost calls of a very deep stack are recorded */
+  depth = 0;
+  for (backlist = backtrace_list; backlist; backlist = backlist->next)
+    {
+      if (depth == PROFILE_DEPTH)
+	{
+	  bcopy (stack + 1, stack, (PROFILE_DEPTH - 1) * sizeof *stack);
+	  depth--;
+	}
+      stack[depth++] = backlist;
+    }
+
+  /* Find the path down the tree for these calls, outermost first */
+  node = profile_nodes;
+  for (i = 0; i < depth; i++)
+    {
+      fun = *stack[depth - 1 - i]->function;
+      for (child = node->children; child; child = child->next)
+	if (EQ (child->fun, fun))
+	  break;
+      if (!child)
+	{
+	  if (profile_nodes_used == PROFILE_NODES)
+	    {
+	      profile_lost_samples++;
+	      return;
+	    }
+	  child = &profile_nodes[profile_nodes_used++];
+	  child->fun = fun;
+	  child->total = child->self = 0;
+	  child->children = 0;
+	  child->next = node->children;
+	  node->children = child;
+	}
+      path[i] = node = child;
+    }
+
+  profile_nodes->total++;
+  for (i = 0; i < depth; i++)
+    path[i]->total++;
+  node->self++;
+}
+
+/* Mark the functions in the profile tree, using the garbage
+ collector's function `mark', which returns the object's new value.  */
+
+mark_lisp_profile (mark)
+     Lisp_Object (*mark) ();
+{
+  register int i;
+  register Lisp_Object tem;
+
+  for (i = 1; i < profile_nodes_used; i++)
+    {
+      tem = profile_nodes[i].fun;
+      profile_nodes[i].fun = (*mark) (tem);
+    }
+}
+
+static void
+start_profile_timer ()
+{
+#ifdef ITIMER_PROF
+  struct itimerval timer;
+
+  timer.it_interval.tv_sec = profile_interval / 1000;
+  timer.it_interval.tv_usec = profile_interval % 1000 * 1000;
+  timer.it_value = timer.it_interval;
+  signal (SIGPROF, profile_signal);
+  setitimer (ITIMER_PROF, &timer, 0);
+#endif /* ITIMER_PROF */
+}
+
+static void
+stop_profile_timer ()
+{
+#ifdef ITIMER_PROF
+  struct itimerval timer;
+
+  bzero (&timer, sizeof timer);
+  setitimer (ITIMER_PROF, &timer, 0);
+  signal (SIGPROF, SIG_IGN);
+#endif /* ITIMER_PROF */
+}
+
+DEFUN ("lisp-profile-start", Flisp_profile_start, Slisp_profile_start, 0, 1, 0,
+  "Start the Lisp profiler, discarding the data it had collected.\n\
+Every INTERVAL milliseconds (default 10) of CPU time, it records which\n\
+Lisp functions are being called, and from where.\n\
+lisp-profile-stop stops it; lisp-profile-report shows what it found.")
+  (interval)
+     Lisp_Object interval;
+{
+  if (NULL (interval))
+    XFASTINT (interval) = 10;
+  CHECK_NUMBER (interval, 0);
+  if (XINT (interval) <= 0)
+    error ("Lisp profiler interval must be positive");
+#ifndef ITIMER_PROF
+  error ("This system has no timer for the Lisp profiler");
+#endif
+
+  stop_profile_timer ();
+  if (!profile_nodes)
+    profile_nodes = (struct profile_node *)
+      xmalloc (PROFILE_NODES * sizeof (struct profile_node));
+  bzero (profile_nodes, sizeof (struct profile_node));
+  profile_nodes->fun = Qnil;
+  profile_nodes_used = 1;
+  profile_gc_samples = profile_lost_samples = 0;
+  profile_interval = XINT (interval);
+  lisp_profiling = 1;
+  start_profile_timer ();
+  return Qnil;
+}
+
+DEFUN ("lisp-profile-stop", Flisp_profile_stop, Slisp_profile_stop, 0, 0, 0,
+  "Stop the Lisp profiler.  Its data remain for lisp-profile-report.")
+  ()
+{
+  stop_profile_timer ();
+  lisp_profiling = 0;
+  return Qnil;
+}
+
+/* Sort the calls made from `node', and from those, and so on,
+ most samples first.  */
+
+static void
+sort_profile_tree (node)
+     struct profile_node *node;
+{
+  register struct profile_node *child, *next, **tailp;
+
+  child = node->children;
+  node->children = 0;
+  for (; child; child = next)
+    {
+      next = child->next;
+      for (tailp = &node->children; *tailp; tailp = &(*tailp)->next)
+	if ((*tailp)->total < child->total)
+	  break;
+      child->next = *tailp;
+      *tailp = child;
+      sort_profile_tree (child);
+    }
+}
+
+/* Each function that appears in the tree, with its samples:
+ all those taken while some call to it was in progress,
+ and those with it innermost.  */
+
+struct profile_function
+  {
+    Lisp_Object fun;
+    int total, self;
+  };
+
+static struct profile_function *profile_functions;
+static int profile_nfunctions;
+static Lisp_Object profile_function_table;
+
+/* Add the calls in the subtree at `node' to profile_functions.
+ `outer' holds the functions of the `depth' calls outside `node'.
+ A sample counts once for a function, however many times that
+ function is on the stack in it.  */
+
+static void
+count_profile_functions (node, outer, depth)
+     register struct profile_node *node;
+     struct profile_node **outer;
+     int depth;
+{
+  register struct profile_function *f;
+  register struct profile_node *child;
+  register int i;
+  Lisp_Object tem;
+
+  tem = Fgethash (node->fun, profile_function_table, Qnil);
+  if (NULL (tem))
+    {
+      f = &profile_functions[profile_nfunctions];
+      f->fun = node->fun;
+      f->total = f->self = 0;
+      Fputhash (node->fun, make_number (profile_nfunctions++),
+		profile_function_table);
+    }
+  else
+    f = &profile_functions[XFASTINT (tem)];
+
+  for (i = 0; i < depth; i++)
+    if (EQ (outer[i]->fun, node->fun))
+      break;
+  if (i == depth)
+    f->total += node->total;
+  f->self += node->self;
+
+  outer[depth] = node;
+  for (child = node->children; child; child = child->next)
+    count_profile_functions (child, outer, depth + 1);
+}
+
+static void
+print_profile_counts (total, self, indent)
+     int total, self, indent;
+{
+  char buf[30];
+
+  while (indent-- > 0)
+    write_string (" ", 1);
+  sprintf (buf, "%6d %6d  ", total, self);
+  write_string (buf, -1);
+}
+
+static void
+print_profile_tree (node, indent)
+     register struct profile_node *node;
+     int indent;
+{
+  for (node = node->children; node; node = node->next)
+    {
+      print_profile_counts (node->total, node->self, indent);
+      Fprin1 (node->fun, Qnil);
+      write_string ("\n", 1);
+      print_profile_tree (node, indent + 2);
+    }
+}
+
+static Lisp_Object
+lisp_profile_report_1 ()
+{
+  register int i, j;
+  register struct profile_node *node;
+  struct profile_node **outer;
+  struct profile_function f;
+  char buf[100];
+
+  sprintf (buf, "%d samples, one every %d milliseconds of CPU time.\n",
+	   profile_nodes->total, profile_interval);
+  write_string (buf, -1);
+  if (profile_gc_samples || profile_lost_samples)
+    {
+      sprintf (buf, "Not counted below: %d in garbage collection, %d lost.\n",
+	       profile_gc_samples, profile_lost_samples);
+      write_string (buf, -1);
+    }
+
+  /* Count the samples for each function, and sort them */
+  if (profile_functions)
+    free (profile_functions);
+  profile_functions = (struct profile_function *)
+    xmalloc (profile_nodes_used * sizeof (struct profile_function));
+  profile_nfunctions = 0;
+  profile_function_table = Fmake_hash_table (Qnil, Qnil, Qnil);
+  outer = (struct profile_node **)
+    alloca (profile_nodes_used * sizeof (struct profile_node *));
+  for (node = profile_nodes->children; node; node = node->next)
+    count_profile_functions (node, outer, 0);
+  profile_function_table = Qnil;
+  for (i = 1; i < profile_nfunctions; i++)
+    {
+      f = profile_functions[i];
+      for (j = i; j > 0 && profile_functions[j - 1].total < f.total; j--)
+	profile_functions[j] = profile_functions[j - 1];
+      profile_functions[j] = f;
+    }
+
+  write_string ("\nFunctions: samples taken during calls to each,\n\
+and samples taken within it rather than in functions it called.\n\n\
+ Total   Self  Function\n", -1);
+  for (i = 0; i < profile_nfunctions; i++)
+    {
+      print_profile_counts (profile_functions[i].total,
+			    profile_functions[i].self, 0);
+      Fprin1 (profile_functions[i].fun, Qnil);
+      write_string ("\n", 1);
+    }
+
+  write_string ("\nCalls, each under the call it was made from.\n\
+C-u 1 C-x $ shows only the outermost calls, C-u 3 C-x $ two levels,\n\
+and so on; C-x $ shows them all again.\n\n\
+ Total   Self  Function\n", -1);
+  print_profile_tree (profile_nodes, 0);
+  return Qnil;
+}
+
+/* Start profiling again after a report, if `arg' is non-nil.  */
+
+static Lisp_Object
+restart_lisp_profile (arg)
+     Lisp_Object arg;
+{
+  if (!NULL (arg))
+    {
+      lisp_profiling = 1;
+      start_profile_timer ();
+    }
+  return Qnil;
+}
+
+DEFUN ("lisp-profile-report", Flisp_profile_report, Slisp_profile_report,
+  0, 0, "",
+  "Display what the Lisp profiler has found since it was started.\n\
+For each function, it shows the samples taken while the function was\n\
+being called, and those of them taken within the function itself.\n\
+Then it shows the tree of calls, each under the call it was made from,\n\
+most samples first.")
+  ()
+{
+  int count = specpdl_ptr - specpdl;
+
+  if (!profile_nodes)
+    error ("The Lisp profiler has not been started");
+
+  /* Don't profile ourselves, but carry on afterward
+     even if making the report is quit or gets an error.  */
+  record_unwind_protect (restart_lisp_profile, lisp_profiling ? Qt : Qnil);
+  Flisp_profile_stop ();
+  sort_profile_tree (profile_nodes);
+  internal_with_output_to_temp_buffer ("*Lisp Profile*",
+				       lisp_profile_report_1, Qnil);
+  unbind_to (count);
+  return Qnil;
+}
+
 syms_of_eval ()
 {
   DefIntVar ("max-specpdl-size", &max_specpdl_size,
@@ -2116,6 +2695,9 @@ If due to eval entry, one arg, 't.");
   staticpro (&Vautoload_queue);
   Vautoload_queue = Qnil;
 
+  staticpro (&profile_function_table);
+  profile_function_table = Qnil;
+
   defsubr (&Sor);
   defsubr (&Sand);
   defsubr (&Sif);
@@ -2150,4 +2732,7 @@ If due to eval entry, one arg, 't.");
   defsubr (&Sfuncall);
   defsubr (&Sbacktrace_debug);
   defsubr (&Sbacktrace);
+  defsubr (&Slisp_profile_start);
+  defsubr (&Slisp_profile_stop);
+  defsubr (&Slisp_profile_report);
 }
@@ -793,6 +793,7 @@ DEFUN ("fillarray", Ffillarray, Sfillarray, 2, 2, 0,
       size = XVECTOR (array)->size;
       for (index = 0; index < size; index++)
 	p[index] = item;
+      remember_store (array, item);
     }
   else if (XTYPE (array) == Lisp_String)
     {
@@ -1221,10 +1222,292 @@ load FILENAME.  FILENAME is optional and defaults to FEATURE.")
   return feature;
 }
 
+/* Hash tables.  */
+
+Lisp_Object Qhash_table_p, Qeq, Qequal;
+
+/* How deep sxhash looks into conses and vectors.  */
+#define SXHASH_MAX_DEPTH 3
+
+/* Hash code for `obj' suitable for an eq table.
+   No object is moved by garbage collection, so its address will do.  */
+
+static unsigned
+eq_hash (obj)
+     Lisp_Object obj;
+{
+  return (unsigned) XFASTINT (obj);
+}
+
+/* Hash code for `obj' suitable for an equal table:
+   objects that are equal have the same code.  */
+
+static unsigned
+sxhash (obj, depth)
+     Lisp_Object obj;
+     int depth;
+{
+  register unsigned hash;
+  register int i;
+  register unsigned char *p;
+
+  if (depth > SXHASH_MAX_DEPTH)
+    return 0;
+
+  switch (XTYPE (obj))
+    {
+    case Lisp_String:
+      hash = i = XSTRING (obj)->size;
+      for (p = XSTRING (obj)->data; --i >= 0; p++)
+	hash = (hash << 4) + (hash >> 28) + *p;
+      return hash;
+
+    case Lisp_Cons:
+      return (sxhash (XCONS (obj)->car, depth + 1) * 31
+	      + sxhash (XCONS (obj)->cdr, depth + 1));
+
+    case Lisp_Vector:
+      hash = XVECTOR (obj)->size;
+      for (i = 0; i < XVECTOR (obj)->size && i < 4; i++)
+	hash = hash * 31 + sxhash (XVECTOR (obj)->contents[i], depth + 1);
+      return hash;
+
+    case Lisp_Marker:
+      /* The position can change, but the buffer cannot.  */
+      return (unsigned) (LISP_WORD) XMARKER (obj)->buffer;
+
+    default:
+      return eq_hash (obj);
+    }
+}
+
+/* Find the entry for `key' in hash table `h'.
+   Return the (KEY . VALUE) cons, or nil if there is none.
+   Store the index of key's bucket in *bucketp.  */
+
+static Lisp_Object
+hash_lookup (h, key, bucketp)
+     register struct Lisp_Hash_Table *h;
+     Lisp_Object key;
+     int *bucketp;
+{
+  register Lisp_Object tail, entry;
+  register int eqtest = EQ (h->test, Qeq);
+
+  *bucketp = (eqtest ? eq_hash (key) : sxhash (key, 0))
+	     % XVECTOR (h->buckets)->size;
+  for (tail = XVECTOR (h->buckets)->contents[*bucketp];
+       LISTP (tail); tail = XCONS (tail)->cdr)
+    {
+      entry = XCONS (tail)->car;
+      if (EQ (XCONS (entry)->car, key)
+	  || (!eqtest && !NULL (Fequal (XCONS (entry)->car, key))))
+	return entry;
+    }
+  return Qnil;
+}
+
+/* Make `h' have about twice as many buckets,
+   moving the existing list cells to their new buckets.  */
+
+static
+hash_table_grow (h)
+     register struct Lisp_Hash_Table *h;
+{
+  Lisp_Object old, new, tail, next;
+  register int i, b, n;
+  int oldsize = XVECTOR (h->buckets)->size;
+  int eqtest = EQ (h->test, Qeq);
+  Lisp_Object key;
+
+  old = h->buckets;
+  n = 2 * oldsize + 1;
+  new = Fmake_vector (make_number (n), Qnil);
+  for (i = 0; i < oldsize; i++)
+    for (tail = XVECTOR (old)->contents[i]; LISTP (tail); tail = next)
+      {
+	next = XCONS (tail)->cdr;
+	key = XCONS (XCONS (tail)->car)->car;
+	b = (eqtest ? eq_hash (key) : sxhash (key, 0)) % n;
+	XCONS (tail)->cdr = XVECTOR (new)->contents[b];
+	remember_cons (tail);
+	XVECTOR (new)->contents[b] = tail;
+      }
+  h->buckets = new;
+}
+
+DEFUN ("make-hash-table", Fmake_hash_table, Smake_hash_table, 0, 3, 0,
+  "Return a new empty hash table.\n\
+TEST says how keys are compared: eq (the default) or equal.\n\
+Non-nil WEAK means the table does not keep its keys from being garbage\n\
+collected; an entry goes away when nothing else refers to its key.\n\
+SIZE, if non-nil, is how many entries the table is expected to hold.")
+  (test, weak, size)
+     Lisp_Object test, weak, size;
+{
+  Lisp_Object val;
+  register struct Lisp_Hash_Table *h;
+  int n = 13;
+
+  if (NULL (test))
+    test = Qeq;
+  if (!EQ (test, Qeq) && !EQ (test, Qequal))
+    error ("Invalid hash table test");
+  if (!NULL (size))
+    {
+      CHECK_NUMBER (size, 2);
+      if (XINT (size) > n)
+	n = XINT (size) | 1;
+    }
+
+  val = Fmake_vector (make_number ((sizeof (struct Lisp_Hash_Table)
+				    - sizeof (struct Lisp_Vector))
+				   / sizeof (Lisp_Object) + 1),
+		      Qnil);
+  XSETTYPE (val, Lisp_Hash_Table);
+  h = XHASH_TABLE (val);
+  h->test = test;
+  h->weak = NULL (weak) ? Qnil : Qt;
+  XFASTINT (h->count) = 0;
+  h->buckets = Fmake_vector (make_number (n), Qnil);
+  return val;
+}
+
+DEFUN ("hash-table-p", Fhash_table_p, Shash_table_p, 1, 1, 0,
+  "T if OBJECT is a hash table.")
+  (obj)
+     Lisp_Object obj;
+{
+  return XTYPE (obj) == Lisp_Hash_Table ? Qt : Qnil;
+}
+
+DEFUN ("gethash", Fgethash, Sgethash, 2, 3, 0,
+  "Return the value for KEY in hash table TABLE.\n\
+If KEY is not there, return DEFAULT (which defaults to nil).")
+  (key, table, dflt)
+     Lisp_Object key, table, dflt;
+{
+  Lisp_Object entry;
+  int bucket;
+
+  CHECK_HASH_TABLE (table, 1);
+  entry = hash_lookup (XHASH_TABLE (table), key, &bucket);
+  return NULL (entry) ? dflt : XCONS (entry)->cdr;
+}
+
+DEFUN ("puthash", Fputhash, Sputhash, 3, 3, 0,
+  "Make KEY's value in hash table TABLE be VALUE.  Return VALUE.")
+  (key, value, table)
+     Lisp_Object key, value, table;
+{
+  register struct Lisp_Hash_Table *h;
+  Lisp_Object entry;
+  int bucket;
+
+  CHECK_HASH_TABLE (table, 2);
+  h = XHASH_TABLE (table);
+  entry = hash_lookup (h, key, &bucket);
+  if (!NULL (entry))
+    {
+      XCONS (entry)->cdr = value;
+      remember_cons (entry);
+      return value;
+    }
+  if (XFASTINT (h->count) >= 2 * XVECTOR (h->buckets)->size)
+    {
+      hash_table_grow (h);
+      hash_lookup (h, key, &bucket);
+    }
+  XVECTOR (h->buckets)->contents[bucket]
+    = Fcons (Fcons (key, value), XVECTOR (h->buckets)->contents[bucket]);
+  remember_object (h->buckets);
+  XFASTINT (h->count)++;
+  return value;
+}
+
+DEFUN ("remhash", Fremhash, Sremhash, 2, 2, 0,
+  "Remove the entry for KEY from hash table TABLE, if there is one.")
+  (key, table)
+     Lisp_Object key, table;
+{
+  register struct Lisp_Hash_Table *h;
+  Lisp_Object entry;
+  int bucket;
+
+  CHECK_HASH_TABLE (table, 1);
+  h = XHASH_TABLE (table);
+  entry = hash_lookup (h, key, &bucket);
+  if (!NULL (entry))
+    {
+      XVECTOR (h->buckets)->contents[bucket]
+	= Fdelq (entry, XVECTOR (h->buckets)->contents[bucket]);
+      remember_store (h->buckets, XVECTOR (h->buckets)->contents[bucket]);
+      XFASTINT (h->count)--;
+    }
+  return Qnil;
+}
+
+DEFUN ("clrhash", Fclrhash, Sclrhash, 1, 1, 0,
+  "Remove all entries from hash table TABLE.")
+  (table)
+     Lisp_Object table;
+{
+  register struct Lisp_Hash_Table *h;
+  register int i;
+
+  CHECK_HASH_TABLE (table, 0);
+  h = XHASH_TABLE (table);
+  for (i = 0; i < XVECTOR (h->buckets)->size; i++)
+    XVECTOR (h->buckets)->contents[i] = Qnil;
+  XFASTINT (h->count) = 0;
+  return Qnil;
+}
+
+DEFUN ("hash-table-count", Fhash_table_count, Shash_table_count, 1, 1, 0,
+  "Return the number of entries in hash table TABLE.")
+  (table)
+     Lisp_Object table;
+{
+  CHECK_HASH_TABLE (table, 0);
+  return XHASH_TABLE (table)->count;
+}
+
+DEFUN ("maphash", Fmaphash, Smaphash, 2, 2, 0,
+  "Call FUNCTION for each entry in hash table TABLE, with KEY and VALUE.\n\
+FUNCTION may change the value of the entry it is called for,\n\
+or remove that entry, but should not add entries.")
+  (function, table)
+     Lisp_Object function, table;
+{
+  Lisp_Object buckets, tail, next, entry;
+  register int i;
+  struct gcpro gcpro1, gcpro2, gcpro3, gcpro4;
+
+  CHECK_HASH_TABLE (table, 1);
+  buckets = XHASH_TABLE (table)->buckets;
+  tail = next = Qnil;
+  GCPRO4 (function, buckets, tail, next);
+  for (i = 0; i < XVECTOR (buckets)->size; i++)
+    for (tail = XVECTOR (buckets)->contents[i]; LISTP (tail); tail = next)
+      {
+	next = XCONS (tail)->cdr;
+	entry = XCONS (tail)->car;
+	call2 (function, XCONS (entry)->car, XCONS (entry)->cdr);
+      }
+  UNGCPRO;
+  return Qnil;
+}
+
 syms_of_fns ()
 {
   Qstring_lessp = intern ("string-lessp");
   staticpro (&Qstring_lessp);
+  Qhash_table_p = intern ("hash-table-p");
+  staticpro (&Qhash_table_p);
+  Qeq = intern ("eq");
+  staticpro (&Qeq);
+  Qequal = intern ("equal");
+  staticpro (&Qequal);
 
   DefLispVar ("features", &Vfeatures,
     "A list of symbols which are the features of the executing emacs.\n\
@@ -1267,4 +1550,12 @@ Used by  featurep  and  require, and altered by  provide.");
   defsubr (&Sfeaturep);
   defsubr (&Srequire);
   defsubr (&Sprovide);
+  defsubr (&Smake_hash_table);
+  defsubr (&Shash_table_p);
+  defsubr (&Sgethash);
+  defsubr (&Sputhash);
+  defsubr (&Sremhash);
+  defsubr (&Sclrhash);
+  defsubr (&Shash_table_count);
+  defsubr (&Smaphash);
 }
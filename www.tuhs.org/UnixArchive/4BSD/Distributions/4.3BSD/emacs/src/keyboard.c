@@ -662,6 +662,10 @@ get_char (commandflag)
 	  Fdo_auto_save (Qnil);
 	  Keystrokes = 0;
 	}
+      /* Collect garbage now if it will be needed soon,
+	 so that it does not interrupt typing later.  */
+      if (commandflag && !detect_input_pending ())
+	idle_collect_garbage ();
     }
 
   Keystrokes++;
@@ -811,6 +815,9 @@ kbd_buffer_get_char ()
       return c;
     }
 
+  if (virtual_terminal)
+    return vt_read_char ();
+
   /* Either ordinary input buffer or C-g buffered means we can return.  */
   while (!kbd_count)
     {
@@ -860,6 +867,12 @@ kbd_buffer_get_char ()
 get_input_pending (addr)
      int *addr;
 {
+  /* Keystrokes replayed on a virtual terminal never preempt redisplay.  */
+  if (virtual_terminal)
+    {
+      *addr = 0;
+      return;
+    }
 #ifdef FIONREAD
   if (ioctl (0, FIONREAD, addr) < 0)
     *addr = 0;
@@ -1186,11 +1199,11 @@ also, it must satisfy the commandp predicate.")
   if (LISTP (final) || XTYPE (final) == Lisp_Subr)
     {
       backtrace.next = backtrace_list;
-      backtrace_list = &backtrace;
       backtrace.function = &Qcall_interactively;
       backtrace.args = &cmd;
       backtrace.nargs = 1;
       backtrace.evalargs = 0;
+      backtrace_list = &backtrace;
 
       tem = Fcall_interactively (cmd, record);
 
@@ -1559,6 +1572,8 @@ init_keyboard ()
 #else
   interrupt_input = 0;
 #endif
+  if (virtual_terminal)
+    interrupt_input = 0;
 
   sigfree ();
   dribble = 0;
@@ -235,7 +235,10 @@ store_in_keymap (keymap, idx, def)
 				Fcdr (keymap)));
     }
   else
-    XVECTOR (keymap)->contents[idx] = def;
+    {
+      XVECTOR (keymap)->contents[idx] = def;
+      remember_store (keymap, def);
+    }
 
   return def;
 }
@@ -1090,9 +1093,9 @@ DEFUN ("execute-extended-command", Fexecute_extended_command, Sexecute_extended_
   else if (LISTP (prefixarg) && XINT (XCONS (prefixarg)->car) == 4)
     strcpy (buf, "C-u ");
   else if (LISTP (prefixarg) && XTYPE (XCONS (prefixarg)->car) == Lisp_Int)
-    sprintf (buf, "%d ", XINT (XCONS (prefixarg)->car));
+    sprintf (buf, "%ld ", (long) XINT (XCONS (prefixarg)->car));
   else if (XTYPE (prefixarg) == Lisp_Int)
-    sprintf (buf, "%d ", XINT (prefixarg));
+    sprintf (buf, "%ld ", (long) XINT (prefixarg));
 
   strcat (buf, "M-x ");
 
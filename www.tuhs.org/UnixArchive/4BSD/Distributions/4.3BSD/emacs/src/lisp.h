@@ -146,9 +146,24 @@ enum Lisp_Type
 
     /* Window used for Emacs display.
        Data inside looks like a Lisp_Vector.  */
-    Lisp_Window
+    Lisp_Window,
+
+    /* Hash table.  obj.v.hash_table points to a struct Lisp_Hash_Table.
+       Data inside looks like a Lisp_Vector.  */
+    Lisp_Hash_Table
   };
 
+/* LISP_WORD is the integer type that holds a Lisp_Object, and
+   LISPBITS the number of bits in it.  The m- file may make it long
+   on machines whose pointers do not fit in an int; then it should
+   also define VALBITS large enough to hold a pointer.
+   The union type requires LISP_WORD to be int.  */
+
+#ifndef LISP_WORD
+#define LISP_WORD int
+#define LISPBITS INTBITS
+#endif
+
 #ifndef NO_UNION_TYPE
 
 #ifndef BIG_ENDIAN
@@ -223,7 +238,7 @@ Lisp_Object;
 
 #ifdef NO_UNION_TYPE
 
-#define Lisp_Object int
+#define Lisp_Object LISP_WORD
 
 /* These values are overridden by the m- file on some machines.  */
 #ifndef VALBITS
@@ -234,9 +249,10 @@ Lisp_Object;
 #define GCTYPEBITS 7
 #endif
 
-#define VALMASK ((1<<VALBITS) - 1)
-#define GCTYPEMASK ((1<<GCTYPEBITS) - 1)
-#define MARKBIT (1 << (VALBITS + GCTYPEBITS))
+#define VALMASK ((((LISP_WORD) 1) << VALBITS) - 1)
+#define MOST_POSITIVE_FIXNUM (VALMASK >> 1)
+#define GCTYPEMASK ((1 << GCTYPEBITS) - 1)
+#define MARKBIT (((LISP_WORD) 1) << (VALBITS + GCTYPEBITS))
 
 #endif NO_UNION_TYPE
 
@@ -247,20 +263,20 @@ Lisp_Object;
 #ifdef NO_UNION_TYPE
 
 #define XTYPE(a) ((enum Lisp_Type) ((a) >> VALBITS))
-#define XSETTYPE(a, b) ((a)  =  ((a) & VALMASK)  +  ((int)(b) << VALBITS))
+#define XSETTYPE(a, b) ((a)  =  ((a) & VALMASK)  +  ((LISP_WORD)(b) << VALBITS))
 
 /* Use XFASTINT for fast retrieval and storage of integers known
   to be positive.  This takes advantage of the fact that Lisp_Int is 0.  */
 #define XFASTINT(a) (a)
 
-#define XINT(a) (((a) << INTBITS-VALBITS) >> INTBITS-VALBITS)
+#define XINT(a) (((a) << LISPBITS-VALBITS) >> LISPBITS-VALBITS)
 #define XUINT(a) ((a) & VALMASK)
 
 #define XSETINT(a, b) ((a) = ((a) & ~VALMASK)  +  ((b) & VALMASK))
 #define XSETUINT(a, b) ((a) = ((a) & ~VALMASK)  +  ((b) & VALMASK))
 
 #define XSET(var, type, ptr) \
-   ((var) = ((int)(type) << VALBITS) + ((int) (ptr) & VALMASK))
+   ((var) = ((LISP_WORD)(type) << VALBITS) + ((LISP_WORD) (ptr) & VALMASK))
 
 /* During garbage collection, XGCTYPE must be used for extracting types
  so that the mark bit is ignored.  XMARKBIT access the markbit.
@@ -269,8 +285,8 @@ Lisp_Object;
  Outside of garbage collection, all mark bits are always zero.  */
 
 #define XGCTYPE(a) ((enum Lisp_Type) (((a) >> VALBITS) & GCTYPEMASK))
-#define XMARKBIT(a) ((a) & MARKBIT)
-#define XSETMARKBIT(a,b) ((a) = ((a) & ~MARKBIT) + (b))
+#define XMARKBIT(a) (((a) & MARKBIT) != 0)
+#define XSETMARKBIT(a,b) ((a) = ((a) & ~MARKBIT) | ((b) ? MARKBIT : 0))
 #define XMARK(a) ((a) |= MARKBIT)
 #define XUNMARK(a) ((a) &= ~MARKBIT)
 
@@ -311,6 +327,8 @@ Lisp_Object;
 #define XMARK(a) (XMARKBIT(a) = 1)
 #define XUNMARK(a) (XMARKBIT(a) = 0)
 
+#define MOST_POSITIVE_FIXNUM ((1 << 23) - 1)
+
 #endif NO_UNION_TYPE
 
 
@@ -326,19 +344,21 @@ Lisp_Object;
 #define XINTPTR(a) ((int *) XUINT(a))
 #define XWINDOW(a) ((struct window *) XUINT(a))
 #define XPROCESS(a) ((struct Lisp_Process *) XUINT(a))
-
-#define XSETCONS(a, b) XSETUINT(a, (int) (b))
-#define XSETBUFFER(a, b) XSETUINT(a, (int) (b))
-#define XSETVECTOR(a, b) XSETUINT(a, (int) (b))
-#define XSETSUBR(a, b) XSETUINT(a, (int) (b))
-#define XSETSTRING(a, b) XSETUINT(a, (int) (b))
-#define XSETSYMBOL(a, b) XSETUINT(a, (int) (b))
-#define XSETFUNCTION(a, b) XSETUINT(a, (int) (b))
-#define XSETMARKER(a, b) XSETUINT(a, (int) (b))
-#define XSETOBJFWD(a, b) XSETUINT(a, (int) (b))
-#define XSETINTPTR(a, b) XSETUINT(a, (int) (b))
-#define XSETWINDOW(a, b) XSETUINT(a, (int) (b))
-#define XSETPROCESS(a, b) XSETUINT(a, (int) (b))
+#define XHASH_TABLE(a) ((struct Lisp_Hash_Table *) XUINT(a))
+
+#define XSETCONS(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETBUFFER(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETVECTOR(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETSUBR(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETSTRING(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETSYMBOL(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETFUNCTION(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETMARKER(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETOBJFWD(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETINTPTR(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETWINDOW(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETPROCESS(a, b) XSETUINT(a, (LISP_WORD) (b))
+#define XSETHASH_TABLE(a, b) XSETUINT(a, (LISP_WORD) (b))
 
 /* In a cons, the markbit of the car is the gc mark bit */
 
@@ -357,11 +377,13 @@ struct Lisp_Buffer_Cons
     int bufpos;
   };
 
-/* In a string or vector, the sign bit of the `size' is the gc mark bit */
+/* In a string or vector, the sign bit of the `size' is the gc mark bit.
+   A string's size is a whole LISP_WORD, since while the string is
+   being garbage collected it holds the address of the string's copy.  */
 
 struct Lisp_String
   {
-    int size;
+    LISP_WORD size;
     unsigned char data[1];
   };
 
@@ -372,6 +394,23 @@ struct Lisp_Vector
     Lisp_Object contents[1];
   };
 
+/* A hash table is marked by GC like a vector.
+   Each element of `buckets' is a list of (KEY . VALUE) conses.
+   If `weak' is non-nil, GC marks only the values;
+   entries whose keys are otherwise unreferenced are then removed.  */
+
+struct Lisp_Hash_Table
+  {
+    /* The first two fields are really the header of a vector */
+    int size;
+    struct Lisp_Vector *vec_next;
+    Lisp_Object test;		/* eq or equal */
+    Lisp_Object weak;
+    Lisp_Object count;		/* Number of entries */
+    Lisp_Object buckets;
+    Lisp_Object next_weak;	/* Chains weak tables together during GC */
+  };
+
 /* In a symbol, the markbit of the plist is used as the gc mark bit */
 
 struct Lisp_Symbol
@@ -381,6 +420,7 @@ struct Lisp_Symbol
     Lisp_Object function;
     Lisp_Object plist;
     struct Lisp_Symbol *next;	/* -> next symbol in this obarray bucket */
+    int local_index;		/* Index in buffers' local_var_slots, or 0 */
   };
 
 struct Lisp_Subr
@@ -432,24 +472,38 @@ struct Lisp_Marker
 #define CHECK_MARKER(x, i) \
   { if (XTYPE ((x)) != Lisp_Marker) x = wrong_type_argument (Qmarkerp, (x)); }
 
+#define CHECK_HASH_TABLE(x, i) \
+  { if (XTYPE ((x)) != Lisp_Hash_Table) x = wrong_type_argument (Qhash_table_p, (x)); }
+
 #define CHECK_NUMBER_COERCE_MARKER(x, i) \
   { if (XTYPE ((x)) == Lisp_Marker) XFASTINT (x) = marker_position (x); \
     else if (XTYPE ((x)) != Lisp_Int) x = wrong_type_argument (Qinteger_or_marker_p, (x)); }
 
+/* Nonzero if `obj' is in pure storage, which garbage collection
+   need not trace.  This is a test of a single range of addresses,
+   however many segments pure storage has.  */
+
+extern char *pure_base, *pure_limit;
+
 #ifdef VIRT_ADDR_VARIES
 /* For machines like APOLLO where text and data can go anywhere
    in virtual memory.  */
+#define PURE_P(obj) \
+  (XUINT (obj) < (unsigned LISP_WORD) pure_limit \
+   && XUINT (obj) >= (unsigned LISP_WORD) pure_base)
+
 #define CHECK_IMPURE(obj) \
-  { extern int pure[]; \
-    if (XUINT (obj) < (int) ((char *) pure + PURESIZE) \
-	&& XUINT (obj) >= (int) pure) \
-      pure_write_error (); }
+  { if (PURE_P (obj)) pure_write_error (); }
 
 #else /* not VIRT_ADDR_VARIES */
 
+/* Everything up to the end of the data is dumped as pure.  */
+#define PURE_P(obj) \
+  (XUINT (obj) < (unsigned LISP_WORD) pure_limit)
+
 #define CHECK_IMPURE(obj) \
   { extern int my_edata; \
-    if (XUINT (obj) < (unsigned int) &my_edata) \
+    if (XUINT (obj) < (unsigned LISP_WORD) &my_edata) \
       pure_write_error (); }
 #endif /* not VIRT_ADDR_VARIES */
 
@@ -554,6 +608,10 @@ extern int consing_since_gc;
 
 extern int gc_cons_threshold;
 
+/* amount of consing at which the next gc is done */
+
+extern int gc_trigger;
+
 /* Structure for recording stack slots that need marking */
 
 /* This is a chain of structures, each of which points at a Lisp_Object variable
@@ -618,6 +676,7 @@ extern Lisp_Object Qstringp, Qarrayp, Qsequencep, Qbufferp;
 extern Lisp_Object Qchar_or_string_p, Qmarkerp, Qvectorp;
 extern Lisp_Object Qinteger_or_marker_p, Qboundp, Qfboundp;
 extern Lisp_Object Qcdr;
+extern Lisp_Object Qhash_table_p;
 
 extern Lisp_Object Feq (), Fnull (), Flistp (), Fconsp (), Fatom (), Fnlistp ();
 extern Lisp_Object Fintegerp (), Fnatnump (), Fsymbolp ();
@@ -656,6 +715,7 @@ extern Lisp_Object Freverse (), Fnreverse (), Fget (), Fput (), Fequal ();
 extern Lisp_Object Ffillarray (), Fnconc (), Fmapcar (), Fmapconcat ();
 extern Lisp_Object Fy_or_n_p (), Fyes_or_no_p ();
 extern Lisp_Object Ffeaturep (), Frequire () , Fprovide ();
+extern Lisp_Object Fmake_hash_table (), Fgethash (), Fputhash (), Fremhash ();
 extern Lisp_Object concat2 (), nconc2 ();
 
 /* Defined in alloc.c */
@@ -681,13 +741,14 @@ extern Lisp_Object Fread (), Fread_from_string ();
 extern Lisp_Object Fintern (), Fintern_soft (), Fload ();
 extern Lisp_Object Fget_file_char (), Fread_char ();
 extern Lisp_Object Feval_current_buffer (), Feval_region ();
-extern Lisp_Object intern (), oblookup ();
+extern Lisp_Object intern (), oblookup (), obarray_buckets ();
 
 /* Defined in eval.c */
 extern Lisp_Object Qautoload, Qexit, Qinteractive, Qcommandp, Qdefun, Qmacro;
 extern Lisp_Object Vinhibit_quit, Vquit_flag;
 extern Lisp_Object Vmocklisp_arguments, Qmocklisp, Qmocklisp_arguments;
 extern Lisp_Object Vautoload_queue;
+extern int function_generation;
 extern Lisp_Object Fand (), For (), Fif (), Fprogn (), Fprog1 (), Fprog2 ();
 extern Lisp_Object Fsetq (), Fquote ();
 extern Lisp_Object Fuser_variable_p ();
@@ -695,7 +756,7 @@ extern Lisp_Object Fdefun (), Flet (), FletX (), Fwhile ();
 extern Lisp_Object Fcatch (), Fthrow (), Funwind_protect ();
 extern Lisp_Object Fcondition_case (), Fsignal ();
 extern Lisp_Object Ffunction_type (), Fautoload (), Fdocumentation (), Fcommandp ();
-extern Lisp_Object Feval (), Fapply (), Ffuncall ();
+extern Lisp_Object Feval (), Fapply (), Ffuncall (), funcall_from ();
 extern Lisp_Object Fglobal_set (), Fglobal_value (), Fbacktrace ();
 extern Lisp_Object call1 (), call2 (), call3 ();
 extern Lisp_Object apply_lambda ();
@@ -797,6 +858,8 @@ extern Lisp_Object  save_window_restore ();
 extern Lisp_Object decode_env_path ();
 /* Nonzero means don't do interactive redisplay and don't change tty modes */
 extern int noninteractive;
+/* Nonzero means redisplay goes to a simulated terminal (-vt switch) */
+extern int virtual_terminal;
 
 /* defined in process.c */
 extern Lisp_Object Fget_process (), Fget_buffer_process (), Fprocessp ();
@@ -27,6 +27,10 @@ and this notice must be preserved on all copies.  */
 #include "config.h"
 #include "lisp.h"
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
+
 #ifndef standalone
 #include "buffer.h"
 #include "paths.h"
@@ -49,8 +53,22 @@ int load_in_progress;
 /* Search path for files to be loaded. */
 Lisp_Object Vload_path;
 
+/* Directory for caches of the forms read from loaded files, or nil */
+Lisp_Object Vload_cache_directory;
+
+/* A file being loaded: its whole text, and how much of it has been read */
+struct load_file
+  {
+    unsigned char *text;
+    int size;
+    int pos;
+    int mapped;			/* Nonzero if text was mapped with mmap */
+    long mtime;			/* Modification time of the file */
+    struct load_cache *cache;	/* Cache being read or made, or 0 */
+  };
+
 /* File for get_file_char to read from.  Use by load */
-static FILE *instream;
+static struct load_file *instream;
 
 /* When nonzero, read conses in pure space */
 static int read_pure;
@@ -64,58 +82,149 @@ static int read_from_string_limit;
 
 static int unrch;
 
-static int readchar (readcharfun)
+/* When reading from a string, a buffer, a marker or a file being loaded,
+ the text is taken a run of contiguous characters at a time:
+ the rest of the string or file, or the accessible text up to the gap
+ or after it.  READCHAR takes each character from read_ptr without
+ calling readchar until read_end.  read_start is where the run began,
+ at position read_base in read_source.  read_flush stores the position
+ reached back into read_source; this must be done before anything
+ else can look at it or change the text.  */
+
+static unsigned char *read_ptr, *read_end, *read_start;
+static int read_base;
+static Lisp_Object read_source;
+
+/* Store the position reached in the current run back into its source,
+ and stop using the run.  */
+
+static void
+read_flush ()
+{
+  register Lisp_Object source;
+  register int pos;
+
+  if (!read_ptr)
+    return;
+  source = read_source;
+  pos = read_base + (read_ptr - read_start);
+  read_ptr = read_end = read_start = 0;
+  read_source = Qnil;
+
+  if (XTYPE (source) == Lisp_String)
+    read_from_string_index = pos;
+  else if (EQ (source, Qget_file_char))
+    instream->pos = pos;
+  else if (XTYPE (source) == Lisp_Buffer)
+    {
+      if (XBUFFER (source) == bf_cur)
+	bf_text.pointloc = pos;
+      else
+	XBUFFER (source)->text.pointloc = pos;
+    }
+  else
+    Fset_marker (source, make_number (pos), Fmarker_buffer (source));
+}
+
+/* Used as unwind-protect function around reading */
+
+static Lisp_Object
+read_unwind (ignore)
+     Lisp_Object ignore;
+{
+  read_flush ();
+  return Qnil;
+}
+
+/* Start a run of text from `readcharfun', which must be a string,
+ buffer, marker or Qget_file_char.  Return zero if there is no more.  */
+
+static int
+read_fill (readcharfun)
      Lisp_Object readcharfun;
 {
-  Lisp_Object tem;
   register struct buffer_text *inbuffer;
-  register int c, mpos;
+  register int pos, end;
 
-  if (unrch >= 0)
+  if (XTYPE (readcharfun) == Lisp_String)
     {
-      c = unrch;
-      unrch = -1;
-      return c;
+      pos = read_from_string_index;
+      read_start = XSTRING (readcharfun)->data + pos;
+      read_end = XSTRING (readcharfun)->data + read_from_string_limit;
     }
-  if (XTYPE (readcharfun) == Lisp_Buffer)
+  else if (EQ (readcharfun, Qget_file_char))
     {
-      if (XBUFFER (readcharfun) == bf_cur)
-	inbuffer = &bf_text;
-      else
-	inbuffer = &XBUFFER (readcharfun)->text;
-
-      if (inbuffer->pointloc >
-	  inbuffer->size1 + inbuffer->size2 - inbuffer->tail_clip)
-	return -1;
-      c = *(unsigned char *) &(inbuffer->pointloc > inbuffer->size1 ? inbuffer->p2 : inbuffer->p1)[inbuffer->pointloc];
-      inbuffer->pointloc++;
-      return c;
+      if (!instream)
+	{
+	  read_ptr = read_end = read_start = 0;
+	  return 0;
+	}
+      pos = instream->pos;
+      read_start = instream->text + pos;
+      read_end = instream->text + instream->size;
     }
-  if (XTYPE (readcharfun) == Lisp_Marker)
+  else
     {
-      if (XMARKER (readcharfun)->buffer == bf_cur)
-	inbuffer = &bf_text;
+      if (XTYPE (readcharfun) == Lisp_Buffer)
+	{
+	  if (XBUFFER (readcharfun) == bf_cur)
+	    inbuffer = &bf_text;
+	  else
+	    inbuffer = &XBUFFER (readcharfun)->text;
+	  pos = inbuffer->pointloc;
+	}
       else
-	inbuffer = &XMARKER (readcharfun)->buffer->text;
-      mpos = marker_position (readcharfun);
+	{
+	  if (XMARKER (readcharfun)->buffer == bf_cur)
+	    inbuffer = &bf_text;
+	  else
+	    inbuffer = &XMARKER (readcharfun)->buffer->text;
+	  pos = marker_position (readcharfun);
+	}
 
-      if (mpos >
-	  inbuffer->size1 + inbuffer->size2 - inbuffer->tail_clip)
-	return -1;
-      c = *(unsigned char *) &(mpos > inbuffer->size1 ? inbuffer->p2 : inbuffer->p1)[mpos];
-      if (mpos != inbuffer->size1 + 1)
-	XMARKER (readcharfun)->bufpos++;
+      /* Stop at the gap or at the end of the accessible text.  */
+      end = inbuffer->size1 + inbuffer->size2 - inbuffer->tail_clip + 1;
+      if (pos <= inbuffer->size1)
+	{
+	  if (end > inbuffer->size1 + 1)
+	    end = inbuffer->size1 + 1;
+	  read_start = inbuffer->p1 + pos;
+	  read_end = inbuffer->p1 + end;
+	}
       else
-	Fset_marker (readcharfun, make_number (mpos + 1),
-		     Fmarker_buffer (readcharfun));
-      return c;
+	{
+	  read_start = inbuffer->p2 + pos;
+	  read_end = inbuffer->p2 + end;
+	}
     }
-  if (EQ (readcharfun, Qget_file_char))
-    return getc (instream);
+  read_base = pos;
+  read_ptr = read_start;
+  read_source = readcharfun;
+  return read_ptr < read_end;
+}
 
-  if (XTYPE (readcharfun) == Lisp_String)
-    return (read_from_string_index < read_from_string_limit) ?
-      XSTRING (readcharfun)->data[read_from_string_index++] : -1;
+static int readchar (readcharfun)
+     Lisp_Object readcharfun;
+{
+  Lisp_Object tem;
+  register int c;
+
+  if (unrch >= 0)
+    {
+      c = unrch;
+      unrch = -1;
+      return c;
+    }
+  if (XTYPE (readcharfun) == Lisp_Buffer
+      || XTYPE (readcharfun) == Lisp_Marker
+      || XTYPE (readcharfun) == Lisp_String
+      || EQ (readcharfun, Qget_file_char))
+    {
+      read_flush ();
+      if (!read_fill (readcharfun))
+	return -1;
+      return *read_ptr++;
+    }
 
   tem = Fapply (readcharfun, Qnil);
 
@@ -124,10 +233,19 @@ static int readchar (readcharfun)
   return XINT (tem);
 }
 
-#define READCHAR readchar(readcharfun)
+#define READCHAR \
+  (unrch < 0 && read_ptr < read_end && EQ (readcharfun, read_source) \
+   ? *read_ptr++ : readchar (readcharfun))
 #define UNREAD(c) (unrch = c)
 
+/* Nonzero if the character just returned by READCHAR
+ is at read_ptr[-1], so that the rest of a token can be scanned
+ in the current run without calling READCHAR.  */
+#define IN_RUN(c) \
+  (EQ (readcharfun, read_source) && read_ptr > read_start && read_ptr[-1] == (c))
+
 static Lisp_Object read0 (), read1 (), read_list (), read_vector ();
+static Lisp_Object read_top (), intern_chars ();
 
 /* get a character from the tty */
 
@@ -152,9 +270,602 @@ DEFUN ("get-file-char", Fget_file_char, Sget_file_char, 0, 0, 0,
   ()
 {
   register Lisp_Object val;
-  XSET (val, Lisp_Int, getc (instream));
+
+  if (EQ (read_source, Qget_file_char))
+    read_flush ();
+  XSET (val, Lisp_Int,
+	instream && instream->pos < instream->size
+	? instream->text[instream->pos++] : -1);
   return val;
 }
+
+/* Get the whole text of the file open on `fd' into `file'.
+ Return 0 if successful, -1 if not.  */
+
+static int
+open_load_file (fd, file)
+     int fd;
+     register struct load_file *file;
+{
+  struct stat st;
+
+  if (fstat (fd, &st) < 0)
+    return -1;
+  file->size = st.st_size;
+  file->mtime = st.st_mtime;
+  file->pos = 0;
+  file->mapped = 0;
+  file->cache = 0;
+#ifdef HAVE_MMAP
+  if (file->size > 0)
+    {
+      file->text = (unsigned char *) mmap (0, file->size, PROT_READ,
+					   MAP_PRIVATE, fd, 0);
+      if (file->text != (unsigned char *) -1)
+	{
+	  file->mapped = 1;
+	  return 0;
+	}
+    }
+#endif /* HAVE_MMAP */
+  file->text = (unsigned char *) malloc (file->size + 1);
+  if (!file->text)
+    return -1;
+  if (read (fd, file->text, file->size) != file->size)
+    {
+      free (file->text);
+      return -1;
+    }
+  return 0;
+}
+
+/* Free the text of `file'.  */
+
+static void
+close_load_file (file)
+     register struct load_file *file;
+{
+#ifdef HAVE_MMAP
+  if (file->mapped)
+    munmap (file->text, file->size);
+  else
+#endif /* HAVE_MMAP */
+    free (file->text);
+}
+
+/* Caches of the forms read from loaded files.
+
+ When load-cache-directory is a directory name, loading a file also
+ records each top level form read from it, in a compact form, in a
+ cache file in that directory named after the loaded file.  The next
+ load of the same file, if its size and modification time are as they
+ were, takes the forms from the cache and need not read the text.
+
+ A cache holds a header, then for each form the character `F', the
+ position in the file where reading the form stopped, the number of
+ conses the form holds and the form itself; the character `E' ends it.
+ All numbers are written seven bits to a byte, low bits first, with
+ the top bit set in all but the last byte.  Each object starts with
+ one of the codes below.  A symbol is written by name the first time
+ it appears and by number after that.  */
+
+#define CACHE_MAGIC "ELCACHE\001"
+#define CACHE_MAGIC_SIZE 8
+
+#define CACHE_NIL 0		/* nil */
+#define CACHE_INT 1		/* Number, as 2n or -2n-1 */
+#define CACHE_NEW_SYMBOL 2	/* Length and chars of name */
+#define CACHE_SYMBOL 3		/* Number of a symbol written before */
+#define CACHE_STRING 4		/* Length and chars */
+#define CACHE_LIST 5		/* Number of elements, elements, tail */
+#define CACHE_VECTOR 6		/* Size and elements */
+
+struct load_cache
+  {
+    char *name;			/* Name of the cache file */
+    int reading;		/* Nonzero if the cache is valid */
+    int writing;		/* Nonzero if making a new cache */
+
+    /* When reading: the cache file, and the symbols it names */
+    struct load_file in;
+    int damaged;		/* Nonzero if the cache made no sense */
+    int nsymbols, symbols_size;
+    unsigned char **names;	/* Where each symbol's name is */
+    int *lengths;		/* How long each name is */
+    Lisp_Object *symbols;	/* Each symbol, or 0 if not interned yet */
+    Lisp_Object obarray;	/* Obarray those symbols are in */
+    Lisp_Object pool;		/* Conses for the form being read */
+    int pool_left;		/* Number of conses left in pool */
+
+    /* When writing: the text of the new cache,
+       and a hash table giving the number of each symbol written */
+    unsigned char *out;
+    int out_fill, out_size;
+    Lisp_Object out_symbols;
+    int out_nsymbols;
+  };
+
+/* Append the `len' chars at `ptr' to the cache `cache' being made.  */
+
+static void
+cache_chars (cache, ptr, len)
+     register struct load_cache *cache;
+     unsigned char *ptr;
+     int len;
+{
+  if (cache->out_fill + len > cache->out_size)
+    {
+      cache->out_size = 2 * cache->out_size + len;
+      cache->out = (unsigned char *) xrealloc (cache->out, cache->out_size);
+    }
+  bcopy (ptr, cache->out + cache->out_fill, len);
+  cache->out_fill += len;
+}
+
+static void
+cache_number (cache, n)
+     struct load_cache *cache;
+     register unsigned LISP_WORD n;
+{
+  unsigned char buf[2 * sizeof n];
+  register int i = 0;
+
+  while (n >= 0200)
+    {
+      buf[i++] = (n & 0177) | 0200;
+      n >>= 7;
+    }
+  buf[i++] = n;
+  cache_chars (cache, buf, i);
+}
+
+static void
+cache_code (cache, code)
+     struct load_cache *cache;
+     int code;
+{
+  unsigned char c = code;
+  cache_chars (cache, &c, 1);
+}
+
+/* Return the number of conses in the list structure of `obj'.  */
+
+static int
+cache_count_conses (obj)
+     register Lisp_Object obj;
+{
+  register int n = 0, i;
+
+  while (1)
+    {
+      if (XTYPE (obj) == Lisp_Vector)
+	{
+	  for (i = 0; i < XVECTOR (obj)->size; i++)
+	    n += cache_count_conses (XVECTOR (obj)->contents[i]);
+	  return n;
+	}
+      if (XTYPE (obj) != Lisp_Cons)
+	return n;
+      n++;
+      n += cache_count_conses (XCONS (obj)->car);
+      obj = XCONS (obj)->cdr;
+    }
+}
+
+/* Append `obj' to the cache `cache' being made.
+ Return zero if `obj' is not something the reader makes.  */
+
+static int
+cache_object (cache, obj)
+     register struct load_cache *cache;
+     register Lisp_Object obj;
+{
+  register Lisp_Object tail, tem;
+  register int n, i;
+  register LISP_WORD num;
+
+  switch (XTYPE (obj))
+    {
+    case Lisp_Int:
+      cache_code (cache, CACHE_INT);
+      num = XINT (obj);
+      cache_number (cache, num < 0 ? -2 * (unsigned LISP_WORD) num - 1
+		    : 2 * (unsigned LISP_WORD) num);
+      return 1;
+
+    case Lisp_Symbol:
+      if (NULL (obj))
+	{
+	  cache_code (cache, CACHE_NIL);
+	  return 1;
+	}
+      tem = Fgethash (obj, cache->out_symbols, Qnil);
+      if (!NULL (tem))
+	{
+	  cache_code (cache, CACHE_SYMBOL);
+	  cache_number (cache, XFASTINT (tem));
+	  return 1;
+	}
+      Fputhash (obj, make_number (cache->out_nsymbols++),
+		cache->out_symbols);
+      cache_code (cache, CACHE_NEW_SYMBOL);
+      cache_number (cache, XSYMBOL (obj)->name->size);
+      cache_chars (cache, XSYMBOL (obj)->name->data,
+		   XSYMBOL (obj)->name->size);
+      return 1;
+
+    case Lisp_String:
+      cache_code (cache, CACHE_STRING);
+      cache_number (cache, XSTRING (obj)->size);
+      cache_chars (cache, XSTRING (obj)->data, XSTRING (obj)->size);
+      return 1;
+
+    case Lisp_Cons:
+      for (n = 0, tail = obj; XTYPE (tail) == Lisp_Cons;
+	   tail = XCONS (tail)->cdr)
+	n++;
+      cache_code (cache, CACHE_LIST);
+      cache_number (cache, n);
+      for (tail = obj; XTYPE (tail) == Lisp_Cons; tail = XCONS (tail)->cdr)
+	if (!cache_object (cache, XCONS (tail)->car))
+	  return 0;
+      return cache_object (cache, tail);
+
+    case Lisp_Vector:
+      cache_code (cache, CACHE_VECTOR);
+      cache_number (cache, XVECTOR (obj)->size);
+      for (i = 0; i < XVECTOR (obj)->size; i++)
+	if (!cache_object (cache, XVECTOR (obj)->contents[i]))
+	  return 0;
+      return 1;
+    }
+  return 0;
+}
+
+/* Record in the cache `cache' the form `form',
+ whose reading stopped at position `pos' in the file.  */
+
+static void
+cache_form (cache, form, pos)
+     register struct load_cache *cache;
+     Lisp_Object form;
+     int pos;
+{
+  int fill = cache->out_fill;
+
+  cache_code (cache, 'F');
+  cache_number (cache, pos);
+  cache_number (cache, cache_count_conses (form));
+  if (!cache_object (cache, form))
+    {
+      cache->out_fill = fill;
+      cache->writing = 0;
+    }
+}
+
+/* Read a number from the cache being read.  */
+
+static unsigned LISP_WORD
+cache_read_number (cache)
+     register struct load_cache *cache;
+{
+  register unsigned LISP_WORD n = 0;
+  register int shift = 0, c;
+
+  do
+    {
+      if (cache->in.pos >= cache->in.size
+	  || shift >= 8 * sizeof n)
+	{
+	  cache->damaged = 1;
+	  return 0;
+	}
+      c = cache->in.text[cache->in.pos++];
+      n |= (unsigned LISP_WORD) (c & 0177) << shift;
+      shift += 7;
+    }
+  while (c & 0200);
+  return n;
+}
+
+/* Read a length from the cache being read,
+ and check that that many chars or objects can follow.  */
+
+static int
+cache_read_length (cache)
+     register struct load_cache *cache;
+{
+  register unsigned LISP_WORD n = cache_read_number (cache);
+
+  if (n > cache->in.size - cache->in.pos)
+    {
+      cache->damaged = 1;
+      return 0;
+    }
+  return n;
+}
+
+/* Read an object from the cache being read.
+ Its conses are taken from cache->pool.  */
+
+static Lisp_Object
+cache_read_object (cache)
+     register struct load_cache *cache;
+{
+  register unsigned LISP_WORD n;
+  register int i;
+  Lisp_Object val, tail, tem;
+
+  if (cache->damaged || cache->in.pos >= cache->in.size)
+    {
+      cache->damaged = 1;
+      return Qnil;
+    }
+  switch (cache->in.text[cache->in.pos++])
+    {
+    case CACHE_NIL:
+      return Qnil;
+
+    case CACHE_INT:
+      n = cache_read_number (cache);
+      XSET (val, Lisp_Int, n & 1 ? - (LISP_WORD) (n >> 1) - 1
+	    : (LISP_WORD) (n >> 1));
+      return val;
+
+    case CACHE_NEW_SYMBOL:
+      n = cache_read_length (cache);
+      if (cache->nsymbols == cache->symbols_size)
+	{
+	  cache->symbols_size = 2 * cache->symbols_size + 100;
+	  cache->names = (unsigned char **)
+	    xrealloc (cache->names,
+		      cache->symbols_size * sizeof *cache->names);
+	  cache->lengths = (int *)
+	    xrealloc (cache->lengths,
+		      cache->symbols_size * sizeof *cache->lengths);
+	  cache->symbols = (Lisp_Object *)
+	    xrealloc (cache->symbols,
+		      cache->symbols_size * sizeof *cache->symbols);
+	}
+      i = cache->nsymbols++;
+      cache->names[i] = cache->in.text + cache->in.pos;
+      cache->lengths[i] = n;
+      cache->symbols[i] = 0;
+      cache->in.pos += n;
+      goto symbol;
+
+    case CACHE_SYMBOL:
+      i = cache_read_number (cache);
+      if (i < 0 || i >= cache->nsymbols)
+	break;
+    symbol:
+      if (XTYPE (cache->symbols[i]) != Lisp_Symbol)
+	cache->symbols[i] = intern_chars (cache->names[i], cache->lengths[i]);
+      return cache->symbols[i];
+
+    case CACHE_STRING:
+      n = cache_read_length (cache);
+      val = make_string (cache->in.text + cache->in.pos, n);
+      cache->in.pos += n;
+      return val;
+
+    case CACHE_LIST:
+      n = cache_read_length (cache);
+      if (n == 0 || n > cache->pool_left)
+	break;
+      /* Take the first n conses of the pool for this list.  */
+      val = tail = cache->pool;
+      for (i = 1; i < n; i++)
+	tail = XCONS (tail)->cdr;
+      cache->pool = XCONS (tail)->cdr;
+      cache->pool_left -= n;
+      for (tem = val; ; tem = XCONS (tem)->cdr)
+	{
+	  XCONS (tem)->car = cache_read_object (cache);
+	  if (EQ (tem, tail))
+	    break;
+	}
+      XCONS (tail)->cdr = cache_read_object (cache);
+      return val;
+
+    case CACHE_VECTOR:
+      n = cache_read_length (cache);
+      val = Fmake_vector (make_number (n), Qnil);
+      for (i = 0; i < n; i++)
+	XVECTOR (val)->contents[i] = cache_read_object (cache);
+      return val;
+    }
+  cache->damaged = 1;
+  return Qnil;
+}
+
+/* Evaluate with `evalfun' the forms in `file's cache.
+ Return nonzero if that did the whole file.  Otherwise, return zero,
+ leaving file->pos where reading the rest of the file should start.
+ That happens if evaluating a form reads more of the file,
+ or if the cache proves to be damaged.  */
+
+static int
+cache_evalloop (file, evalfun)
+     register struct load_file *file;
+     Lisp_Object (*evalfun) ();
+{
+  register struct load_cache *cache = file->cache;
+  register int pos, n, i;
+  Lisp_Object val;
+  int count = specpdl_ptr - specpdl;
+
+  specbind (Qstandard_input, Qget_file_char);
+  cache->obarray = Vobarray;
+
+  while (!cache->damaged && cache->in.pos < cache->in.size)
+    {
+      instream = file;
+      if (cache->in.text[cache->in.pos] == 'E')
+	{
+	  file->pos = file->size;
+	  unbind_to (count);
+	  return 1;
+	}
+      if (cache->in.text[cache->in.pos++] != 'F')
+	break;
+      pos = cache_read_number (cache);
+      n = cache_read_length (cache);
+      if (cache->damaged || pos < file->pos || pos > file->size)
+	break;
+
+      /* The symbols found so far must be found again
+	 if an earlier form changed which obarray is in use.  */
+      if (!EQ (Vobarray, cache->obarray))
+	{
+	  for (i = 0; i < cache->nsymbols; i++)
+	    cache->symbols[i] = 0;
+	  cache->obarray = Vobarray;
+	}
+
+      cache->pool = Fmake_list (make_number (n), Qnil);
+      cache->pool_left = n;
+      val = cache_read_object (cache);
+      cache->pool = Qnil;
+      if (cache->damaged)
+	break;
+
+      file->pos = pos;
+      unrch = -1;
+      (*evalfun) (val);
+      if (file->pos != pos)
+	{
+	  unbind_to (count);
+	  return 0;
+	}
+    }
+
+  /* The cache is no good; get rid of it so the next load makes anew.  */
+  unlink (cache->name);
+  unbind_to (count);
+  return 0;
+}
+
+/* Set up `cache' for loading `file' from the file named `found':
+ read its cache if there is one and it is still valid,
+ or else get ready to make a new one.  */
+
+static void
+open_load_cache (cache, file, found)
+     register struct load_cache *cache;
+     register struct load_file *file;
+     Lisp_Object found;
+{
+  register Lisp_Object dir = Vload_cache_directory;
+  register int fd, i, n;
+  register char *p;
+
+  cache->name = (char *) xmalloc (XSTRING (dir)->size
+				  + XSTRING (found)->size + 2);
+  bcopy (XSTRING (dir)->data, cache->name, XSTRING (dir)->size);
+  p = cache->name + XSTRING (dir)->size;
+  if (p != cache->name && p[-1] != '/')
+    *p++ = '/';
+  /* Name the cache after the whole file name, slashes and all.  */
+  for (i = 0; i < XSTRING (found)->size; i++)
+    *p++ = XSTRING (found)->data[i] == '/' ? '!' : XSTRING (found)->data[i];
+  *p = 0;
+
+  cache->reading = cache->writing = 0;
+  cache->damaged = 0;
+  cache->nsymbols = cache->symbols_size = 0;
+  cache->names = 0;
+  cache->lengths = 0;
+  cache->symbols = 0;
+  cache->pool = Qnil;
+  cache->obarray = Qnil;
+  cache->out = 0;
+  cache->out_symbols = Qnil;
+  file->cache = cache;
+
+  fd = open (cache->name, 0, 0);
+  if (fd >= 0)
+    {
+      if (open_load_file (fd, &cache->in) >= 0)
+	{
+	  cache->reading = 1;
+	  if (cache->in.size < CACHE_MAGIC_SIZE
+	      || bcmp (cache->in.text, CACHE_MAGIC, CACHE_MAGIC_SIZE))
+	    cache->damaged = 1;
+	  cache->in.pos = CACHE_MAGIC_SIZE;
+	  if (!cache->damaged
+	      && cache_read_number (cache) == file->size
+	      && cache_read_number (cache) == file->mtime
+	      && (n = cache_read_length (cache)) == XSTRING (found)->size
+	      && !bcmp (cache->in.text + cache->in.pos,
+			XSTRING (found)->data, n)
+	      && !cache->damaged)
+	    {
+	      cache->in.pos += n;
+	      close (fd);
+	      return;
+	    }
+	  close_load_file (&cache->in);
+	  cache->reading = 0;
+	  cache->damaged = 0;
+	}
+      close (fd);
+    }
+
+  cache->writing = 1;
+  cache->out_size = 4 * file->size + 100;
+  cache->out = (unsigned char *) xmalloc (cache->out_size);
+  cache->out_fill = 0;
+  cache->out_symbols = Fmake_hash_table (Qnil, Qnil, Qnil);
+  cache->out_nsymbols = 0;
+  cache_chars (cache, CACHE_MAGIC, CACHE_MAGIC_SIZE);
+  cache_number (cache, file->size);
+  cache_number (cache, file->mtime);
+  cache_number (cache, XSTRING (found)->size);
+  cache_chars (cache, XSTRING (found)->data, XSTRING (found)->size);
+}
+
+/* Write out the cache `cache' made while loading a file.
+ It is written under another name and then renamed,
+ so that another Emacs never reads half a cache.  */
+
+static void
+write_load_cache (cache)
+     register struct load_cache *cache;
+{
+  register char *temp;
+  register int fd, ok;
+
+  cache_code (cache, 'E');
+  temp = (char *) alloca (strlen (cache->name) + 2);
+  strcpy (temp, cache->name);
+  strcat (temp, "#");
+  fd = creat (temp, 0666);
+  if (fd < 0)
+    return;
+  ok = write (fd, cache->out, cache->out_fill) == cache->out_fill;
+  if (close (fd) < 0)
+    ok = 0;
+  if (!ok || rename (temp, cache->name) < 0)
+    unlink (temp);
+}
+
+static void
+close_load_cache (cache)
+     register struct load_cache *cache;
+{
+  if (cache->reading)
+    close_load_file (&cache->in);
+  if (cache->names)
+    {
+      free (cache->names);
+      free (cache->lengths);
+      free (cache->symbols);
+    }
+  if (cache->out)
+    free (cache->out);
+  free (cache->name);
+}
 
 void readevalloop ();
 Lisp_Object load_unwind ();
@@ -171,11 +882,13 @@ Return t if file exists.")
   (str, missing_ok, nomessage)
      Lisp_Object str, missing_ok, nomessage;
 {
-  register FILE *stream;
+  struct load_file file;
+  struct load_cache cache;
   register int fd = -1;
   register Lisp_Object lispstream;
+  Lisp_Object found;
   int count = specpdl_ptr - specpdl;
-  struct gcpro gcpro1;
+  struct gcpro gcpro1, gcpro2;
 
   CHECK_STRING (str, 0);
   str = Fsubstitute_in_file_name (str);
@@ -184,11 +897,11 @@ Return t if file exists.")
      since it would try to load a directory as a Lisp file */
   if (XSTRING (str)->size > 0)
     {
-      fd = openp (Vload_path, str, ".elc", 0, 0);
+      fd = openp (Vload_path, str, ".elc", &found, 0);
       if (fd < 0)
-	fd = openp (Vload_path, str, ".el", 0, 0);
+	fd = openp (Vload_path, str, ".el", &found, 0);
       if (fd < 0)
-	fd = openp (Vload_path, str, "", 0, 0);
+	fd = openp (Vload_path, str, "", &found, 0);
     }
 
   if (fd < 0)
@@ -198,21 +911,31 @@ Return t if file exists.")
 				     Fcons (str, Qnil)));
     else return Qnil;
 
-  stream = fdopen (fd, "r");
-  if (stream == 0)
+  if (open_load_file (fd, &file) < 0)
     {
       close (fd);
-      error ("Failure to create stdio stream for %s", XSTRING (str)->data);
+      error ("Cannot read load file %s", XSTRING (str)->data);
     }
-  XSET (lispstream, Lisp_Internal_Stream, (int) stream);
+  close (fd);
+  XSET (lispstream, Lisp_Internal_Stream, (LISP_WORD) &file);
 
   if (NULL (nomessage))
     message ("Loading %s...", XSTRING (str)->data);
 
-  GCPRO1 (str);
+  /* Forms read while purifying go in pure space, which a cache
+     cannot give them, so use no cache then.  */
+  cache.out_symbols = Qnil;
+  if (XTYPE (Vload_cache_directory) == Lisp_String
+      && NULL (Vpurify_flag))
+    open_load_cache (&cache, &file, found);
+
+  GCPRO2 (str, cache.out_symbols);
   record_unwind_protect (load_unwind, lispstream);
   load_in_progress = 1;
-  readevalloop (Qget_file_char, stream, Feval, 0);
+  if (!file.cache || !file.cache->reading || !cache_evalloop (&file, Feval))
+    readevalloop (Qget_file_char, &file, Feval, 0);
+  if (file.cache && file.cache->writing)
+    write_load_cache (file.cache);
   unbind_to (count);
   UNGCPRO;
 
@@ -288,7 +1011,13 @@ Lisp_Object
 load_unwind (stream)  /* used as unwind-protect function in load */
      Lisp_Object stream;
 {
-  fclose ((FILE *) XSTRING (stream));
+  register struct load_file *file = (struct load_file *) XSTRING (stream);
+
+  if (EQ (read_source, Qget_file_char))
+    read_flush ();
+  close_load_file (file);
+  if (file->cache)
+    close_load_cache (file->cache);
   load_in_progress = 0;
   return Qnil;
 }
@@ -303,16 +1032,17 @@ unreadpure ()	/* Used as unwind-protect function in readevalloop */
 void
 readevalloop (readcharfun, stream, evalfun, printflag)
      Lisp_Object readcharfun;
-     FILE *stream;     
+     struct load_file *stream;
      Lisp_Object (*evalfun) ();
      int printflag;
 {
   register int c;
   register Lisp_Object val;
-  register int xunrch;
+  register int xunrch, pos;
   int count = specpdl_ptr - specpdl;
 
   specbind (Qstandard_input, readcharfun);
+  record_unwind_protect (read_unwind, Qnil);
 
   unrch = -1;
 
@@ -332,7 +1062,7 @@ readevalloop (readcharfun, stream, evalfun, printflag)
 	{
 	  record_unwind_protect (unreadpure, Qnil);
 	  val = read_list (-1, readcharfun);
-	  unbind_to (count + 1);
+	  unbind_to (count + 2);
 	}
       else
 	{
@@ -340,9 +1070,17 @@ readevalloop (readcharfun, stream, evalfun, printflag)
 	  val = read0 (readcharfun);
 	}
 
+      read_flush ();
       xunrch = unrch;
       unrch = -1;
+      pos = stream ? stream->pos : 0;
+      if (stream && stream->cache && stream->cache->writing)
+	cache_form (stream->cache, val, pos);
       val = (*evalfun) (val);
+      /* A form that reads more of the file itself
+	 leaves the rest of the file unfit to cache.  */
+      if (stream && stream->cache && stream->pos != pos)
+	stream->cache->writing = 0;
       if (printflag)
 	{
 	  Vvalues = Fcons (val, Vvalues);
@@ -438,7 +1176,7 @@ STREAM or standard-input may be:\n\
   if (XTYPE (readcharfun) == Lisp_String)
     return Fcar (Fread_from_string (readcharfun, Qnil, Qnil));
 
-  return read0 (readcharfun);
+  return read_top (readcharfun);
 }
 
 DEFUN ("read-from-string", Fread_from_string, Sread_from_string, 1, 3, 0,
@@ -477,9 +1215,26 @@ START and END optionally delimit a substring of STRING from which to read;\n\
 
   unrch = -1;	/* Allow buffering-back only within a read. */
 
-  tem = read0 (string);
+  tem = read_top (string);
   return Fcons (tem, make_number (read_from_string_index));
 }
+
+/* Read one expression from `readcharfun' with read0,
+ storing back how far it read even if there is an error.  */
+
+static Lisp_Object
+read_top (readcharfun)
+     Lisp_Object readcharfun;
+{
+  register Lisp_Object val;
+  int count = specpdl_ptr - specpdl;
+
+  read_flush ();
+  record_unwind_protect (read_unwind, Qnil);
+  val = read0 (readcharfun);
+  unbind_to (count);
+  return val;
+}
 
 /* Use this for recursive reads, in contexts where internal tokens are not allowed. */
 
@@ -508,6 +1263,7 @@ read1 (readcharfun)
      register Lisp_Object readcharfun;
 {
   register int c;
+  register unsigned char *p1;
 
  retry:
 
@@ -555,6 +1311,24 @@ read1 (readcharfun)
       }
 
     case '\"':
+      /* If the string is all in the current run and has no escapes,
+	 make it from there.  As below, the char after the closing
+	 quote is read to see if it doubles the quote, then unread.  */
+      if (IN_RUN (c))
+	{
+	  register unsigned char *start = read_ptr, *q = read_ptr;
+
+	  while (q < read_end && *q != '\"' && *q != '\\')
+	    q++;
+	  if (q + 1 < read_end && *q == '\"' && q[1] != '\"')
+	    {
+	      read_ptr = q + 2;
+	      UNREAD (q[1]);
+	      if (read_pure)
+		return make_pure_string (start, q - start);
+	      return make_string (start, q - start);
+	    }
+	}
       {
 	register char *p = read_buffer;
 	register char *end = read_buffer + read_buffer_size;
@@ -598,6 +1372,46 @@ read1 (readcharfun)
 
     default:
       if (c <= 040) goto retry;
+
+      /* If the token is all in the current run and has no escapes,
+	 look it up where it is rather than a char at a time.  */
+      if (c != '\\' && IN_RUN (c))
+	{
+	  register unsigned char *start = read_ptr - 1, *q = read_ptr;
+	  register int d;
+	  register Lisp_Object val;
+
+	  while (q < read_end && (d = *q) > 040
+		 && !(d == '\"' || d == '\'' || d == ';' || d == '?'
+		      || d == '(' || d == ')' || d =='.'
+		      || d == '[' || d == ']' || d == '#' || d == '\\'))
+	    q++;
+	  if (q < read_end && d != '\\')
+	    {
+	      read_ptr = q + 1;
+	      UNREAD (d);
+
+	      /* Is it an integer?  */
+	      p1 = start;
+	      if (*p1 == '+' || *p1 == '-') p1++;
+	      if (p1 != q)
+		{
+		  while (p1 != q && *p1 >= '0' && *p1 <= '9') p1++;
+		  if (p1 == q)
+		    {
+		      /* Convert it where it is, as atoi would;
+			 it may be longer than read_buffer.  */
+		      d = 0;
+		      for (p1 = start; p1 != q; p1++)
+			if (*p1 >= '0')
+			  d = d * 10 + *p1 - '0';
+		      XSET (val, Lisp_Int, *start == '-' ? - d : d);
+		      return val;
+		    }
+		}
+	      return intern_chars (start, q - start);
+	    }
+	}
       {
 	register char *p = read_buffer;
 
@@ -833,13 +1647,31 @@ Lisp_Object initial_obarray;
 
 static int hash_string ();
 Lisp_Object oblookup ();
+Lisp_Object obarray_buckets ();
+static int chain_length ();
+static int grow_obarray ();
+
+/* When interning makes a bucket's chain this long,
+   count the symbols and grow the obarray if it holds
+   more than OBARRAY_LOAD symbols per bucket.  */
+#define OBARRAY_MAX_CHAIN 8
+#define OBARRAY_LOAD 2
 
 Lisp_Object
 intern (str)
      char *str;
+{
+  return intern_chars (str, strlen (str));
+}
+
+/* Like intern, but `str' is `len' chars long and need not end in a null.  */
+
+static Lisp_Object
+intern_chars (str, len)
+     char *str;
+     int len;
 {
   Lisp_Object tem;
-  int len = strlen (str);
   CHECK_OBARRAY (Vobarray);
   tem = oblookup (Vobarray, str, len);
   if (XTYPE (tem) == Lisp_Symbol)
@@ -877,12 +1709,14 @@ it defaults to the value of  obarray.")
     str = Fpurecopy (str);
   sym = Fmake_symbol (str);
 
-  ptr = &XVECTOR (obarray)->contents[XINT (tem)];
+  ptr = &XVECTOR (obarray_buckets (obarray))->contents[XINT (tem)];
   if (XTYPE (*ptr) == Lisp_Symbol)
     XSYMBOL (sym)->next = XSYMBOL (*ptr);
   else
     XSYMBOL (sym)->next = 0;
   *ptr = sym;
+  if (chain_length (sym) >= OBARRAY_MAX_CHAIN)
+    grow_obarray (obarray);
   return sym;
 }
 
@@ -921,8 +1755,10 @@ oblookup (obarray, ptr, size)
   register Lisp_Object tail;
   Lisp_Object bucket, tem;
 
-  if (XTYPE (obarray) != Lisp_Vector || !(obsize = XVECTOR (obarray)->size))
+  if (XTYPE (obarray) != Lisp_Vector || !XVECTOR (obarray)->size)
     error ("Invalid obarray");
+  obarray = obarray_buckets (obarray);
+  obsize = XVECTOR (obarray)->size;
   hash = hash_string (ptr, size) % obsize;
   bucket = XVECTOR (obarray)->contents[hash];
   for (tail = bucket; XSYMBOL (tail); XSETSYMBOL (tail, XSYMBOL (tail)->next))
@@ -936,6 +1772,10 @@ oblookup (obarray, ptr, size)
   return tem;
 }
 
+/* This is the FNV-1a hash.  Every bit of each character
+   affects the whole result, so names that differ only at the end,
+   such as foo-1 and foo-2, are spread over all the buckets.  */
+
 static int
 hash_string (ptr, len)
      unsigned char *ptr;
@@ -943,18 +1783,92 @@ hash_string (ptr, len)
 {
   register unsigned char *p = ptr;
   register unsigned char *end = p + len;
-  register unsigned char c;
-  register int hash = 0;
+  register unsigned hash = 020107116705;
 
   while (p != end)
     {
-      c = *p++;
-      if (c >= 0140) c -= 40;
-      hash = ((hash<<3) + (hash>>28) + c);
+      hash ^= *p++;
+      hash *= 16777619;
     }
   return hash & 07777777777;
 }
 
+/* An obarray that has grown keeps its symbols in a larger vector
+   that is stored in its first element; its other elements are 0.
+   The obarray itself stays the same object, so variables that hold it
+   need not change.  Return the vector that holds the buckets.  */
+
+Lisp_Object
+obarray_buckets (obarray)
+     Lisp_Object obarray;
+{
+  Lisp_Object first;
+
+  if (XVECTOR (obarray)->size == 0)
+    return obarray;
+  first = XVECTOR (obarray)->contents[0];
+  if (XTYPE (first) == Lisp_Vector)
+    return first;
+  return obarray;
+}
+
+/* Return the number of symbols in the chain starting at `sym'.  */
+
+static int
+chain_length (sym)
+     Lisp_Object sym;
+{
+  register struct Lisp_Symbol *s;
+  register int n = 0;
+
+  for (s = XSYMBOL (sym); s; s = s->next)
+    n++;
+  return n;
+}
+
+/* Move the symbols of `obarray' into about twice as many buckets,
+   if it holds more than OBARRAY_LOAD symbols per bucket.  */
+
+static int
+grow_obarray (obarray)
+     Lisp_Object obarray;
+{
+  Lisp_Object old, new, tail;
+  register struct Lisp_Symbol *s, *next;
+  register int i, count, oldsize, newsize, hash;
+
+  old = obarray_buckets (obarray);
+  oldsize = XVECTOR (old)->size;
+  count = 0;
+  for (i = 0; i < oldsize; i++)
+    if (XTYPE (XVECTOR (old)->contents[i]) == Lisp_Symbol)
+      count += chain_length (XVECTOR (old)->contents[i]);
+  if (count <= OBARRAY_LOAD * oldsize)
+    return;
+
+  newsize = 2 * oldsize + 1;
+  new = Fmake_vector (make_number (newsize), make_number (0));
+  for (i = 0; i < oldsize; i++)
+    {
+      if (XTYPE (XVECTOR (old)->contents[i]) != Lisp_Symbol)
+	continue;
+      for (s = XSYMBOL (XVECTOR (old)->contents[i]); s; s = next)
+	{
+	  next = s->next;
+	  hash = hash_string (s->name->data, s->name->size) % newsize;
+	  tail = XVECTOR (new)->contents[hash];
+	  s->next = XTYPE (tail) == Lisp_Symbol ? XSYMBOL (tail) : 0;
+	  XSETSYMBOL (XVECTOR (new)->contents[hash], s);
+	}
+    }
+
+  /* Now make the obarray forward to the new buckets.  */
+  oldsize = XVECTOR (obarray)->size;
+  for (i = 1; i < oldsize; i++)
+    XVECTOR (obarray)->contents[i] = make_number (0);
+  XVECTOR (obarray)->contents[0] = new;
+}
+
 void
 map_obarray (obarray, fn, arg)
      Lisp_Object obarray;
@@ -964,6 +1878,7 @@ map_obarray (obarray, fn, arg)
   register int i;
   register Lisp_Object tail;
   CHECK_VECTOR (obarray, 1);
+  obarray = obarray_buckets (obarray);
   for (i = XVECTOR (obarray)->size - 1; i >= 0; i--)
     for (tail = XVECTOR (obarray)->contents[i];
 	 XTYPE (tail) == Lisp_Symbol && XSYMBOL (tail);
@@ -997,6 +1912,43 @@ OBARRAY defaults to the value of  obarray.")
   return Qnil;
 }
 
+DEFUN ("obarray-statistics", Fobarray_statistics, Sobarray_statistics, 0, 1, 0,
+  "Return a list describing how the symbols in OBARRAY are distributed.\n\
+The list is (SYMBOLS BUCKETS EMPTY-BUCKETS LONGEST-CHAIN).\n\
+OBARRAY defaults to the value of  obarray.")
+  (obarray)
+     Lisp_Object obarray;
+{
+  Lisp_Object tem;
+  register int i, n;
+  int size, count = 0, empty = 0, longest = 0;
+
+  if (NULL (obarray))
+    {
+      CHECK_OBARRAY (Vobarray);
+      obarray = Vobarray;
+    }
+  else
+    CHECK_VECTOR (obarray, 0);
+
+  obarray = obarray_buckets (obarray);
+  size = XVECTOR (obarray)->size;
+  for (i = 0; i < size; i++)
+    {
+      tem = XVECTOR (obarray)->contents[i];
+      n = XTYPE (tem) == Lisp_Symbol ? chain_length (tem) : 0;
+      count += n;
+      if (n == 0)
+	empty++;
+      if (n > longest)
+	longest = n;
+    }
+  return Fcons (make_number (count),
+		Fcons (make_number (size),
+		       Fcons (make_number (empty),
+			      Fcons (make_number (longest), Qnil))));
+}
+
 #define OBARRAY_SIZE 511
 
 void
@@ -1098,6 +2050,7 @@ DefLispVar (namestring, address, doc)
   Lisp_Object sym;
   sym = intern (namestring);
   XSET (XSYMBOL (sym)->value, Lisp_Objfwd, address);
+  remember_forwarded (address);
   Fput (sym, Qvariable_documentation,
 	make_pure_string (doc, strlen (doc)));
 }
@@ -1147,11 +2100,14 @@ syms_of_read ()
   defsubr (&Sread_char);
   defsubr (&Sget_file_char);
   defsubr (&Smapatoms);
+  defsubr (&Sobarray_statistics);
 
   DefLispVar ("obarray", &Vobarray,
     "Symbol table for use by  intern  and  read.\n\
 It is a vector whose length ought to be prime for best results.\n\
-Each element is a list of all interned symbols whose names hash in that bucket.");
+Each element is a list of all interned symbols whose names hash in that bucket.\n\
+When an obarray fills up, intern moves its symbols to a larger vector\n\
+which is kept in the obarray's first element.");
 
   DefLispVar ("values", &Vvalues,
     "List of values of all expressions which were read, evaluated and printed.\n\
@@ -1168,6 +2124,13 @@ Each element is a string (directory name) or nil (try default directory).\n\
 Initialized based on EMACSLOADPATH environment variable, if any,\n\
 otherwise to default specified in by file paths.h when emacs was built.");
 
+  DefLispVar ("load-cache-directory", &Vload_cache_directory,
+    "*Directory in which  load  keeps caches of the forms read from files.\n\
+When a file has not changed since its cache was made, loading it takes\n\
+the forms from the cache instead of reading the text again.\n\
+nil means keep no caches.");
+  Vload_cache_directory = Qnil;
+
   DefBoolVar ("load-in-progress", &load_in_progress,
     "Non-nil iff inside of  load.");
 
@@ -0,0 +1,81 @@
+/* m- file for 64-bit Intel and AMD machines (x86-64).
+   Copyright (C) 1985 Richard M. Stallman.
+
+This file is part of GNU Emacs.
+
+GNU Emacs is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY.  No author or distributor
+accepts responsibility to anyone for the consequences of using it
+or for whether it serves any particular purpose or works at all,
+unless he says so in writing.  Refer to the GNU Emacs General Public
+License for full details.
+
+Everyone is granted permission to copy, modify and redistribute
+GNU Emacs, but only under the conditions described in the
+GNU Emacs General Public License.   A copy of this license is
+supposed to have been given to you along with GNU Emacs so you
+can know your rights and responsibilities.  It should be in a
+file named COPYING.  Among other things, the copyright notice
+and this notice must be preserved on all copies.  */
+
+
+/* The following three symbols give information on
+ the size of various data types.  */
+
+#define SHORTBITS 16		/* Number of bits in a short */
+
+#define INTBITS 32		/* Number of bits in an int */
+
+#define LONGBITS 64		/* Number of bits in a long */
+
+/* x86-64 is not big-endian: lowest numbered byte is least significant. */
+
+#undef BIG_ENDIAN
+
+/* Define how to take a char and sign-extend into an int.
+   On machines where char is signed, this is a no-op.  */
+
+#define SIGN_EXTEND_CHAR(c) (c)
+
+/* Use type long rather than a union, to represent Lisp_Object.
+   Pointers are 64 bits, so a Lisp_Object must be a long.
+   With 56 bits of value, integers and buffer positions
+   are limited only by the int variables that hold them.  */
+
+#define NO_UNION_TYPE
+#define LISP_WORD long
+#define LISPBITS LONGBITS
+#define VALBITS 56
+#define GCTYPEBITS 7
+
+/* Data type of load average, as read out of kmem.  */
+
+#define LOAD_AVE_TYPE double
+
+/* Convert that into an integer that is 100 for a load average of 1.0  */
+
+#define LOAD_AVE_CVT(x) ((int) ((x) * 100.0))
+
+/* Define CANNOT_DUMP on machines where unexec does not work.
+   Then the function dump-emacs will not be defined
+   and temacs will do (load "loadup") automatically unless told otherwise.  */
+
+#define CANNOT_DUMP
+
+/* Shared libraries and address space randomization
+   place text and data anywhere in virtual memory.  */
+
+#define VIRT_ADDR_VARIES
+
+/* The system provides a working alloca.  */
+
+#define HAVE_ALLOCA
+
+/* The system provides mmap, used to read a portable dump.  */
+
+#define HAVE_MMAP
+
+/* Ask for pure storage at an address that is normally free,
+   so that a dumped pure image seldom needs relocating.  */
+
+#define PURE_ADDRESS 0x200000000000
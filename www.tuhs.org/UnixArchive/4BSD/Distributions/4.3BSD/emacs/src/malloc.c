@@ -280,8 +280,8 @@ morecore (nu)			/* ask system for more memory */
       break;
     }
 
-  if ((int) cp & 0x3ff)	/* land on 1K boundaries */
-    sbrk (1024 - ((int) cp & 0x3ff));
+  if ((long) cp & 0x3ff)	/* land on 1K boundaries */
+    sbrk (1024 - ((long) cp & 0x3ff));
 
  /* Take at least 2k, and figure out how many blocks of the desired size
     we're about to get */
@@ -291,9 +291,9 @@ morecore (nu)			/* ask system for more memory */
 
   if ((cp = sbrk (1 << (siz + 3))) == (char *) -1)
     return;			/* no more room! */
-  if ((int) cp & 7)
+  if ((long) cp & 7)
     {		/* shouldn't happen, but just in case */
-      cp = (char *) (((int) cp + 8) & ~7);
+      cp = (char *) (((long) cp + 8) & ~7);
       nblks--;
     }
 
@@ -316,10 +316,11 @@ static
 getpool ()
 {
   register int nu;
+  char *sbrk ();
   register char *cp = sbrk (0);
 
-  if ((int) cp & 0x3ff)	/* land on 1K boundaries */
-    sbrk (1024 - ((int) cp & 0x3ff));
+  if ((long) cp & 0x3ff)	/* land on 1K boundaries */
+    sbrk (1024 - ((long) cp & 0x3ff));
 
   /* Get 2k of storage */
 
@@ -516,10 +517,10 @@ memalign (alignment, size)
   if (ptr == 0)
     return 0;
   /* If entire block has the desired alignment, just accept it.  */
-  if (((int) ptr & (alignment - 1)) == 0)
+  if (((long) ptr & (alignment - 1)) == 0)
     return ptr;
   /* Otherwise, get address of byte in the block that has that alignment.  */
-  aligned = (char *) (((int) ptr + alignment - 1) & -alignment);
+  aligned = (char *) (((long) ptr + alignment - 1) & - (long) alignment);
 
   /* Store a suitable indication of how to free the block,
      so that free can find the true beginning of it.  */
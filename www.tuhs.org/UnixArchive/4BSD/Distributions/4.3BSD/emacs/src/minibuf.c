@@ -379,6 +379,7 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
     tail = alist;
   else
     {
+      alist = obarray_buckets (alist);
       index = 0;
       obsize = XVECTOR (alist)->size;
       bucket = XVECTOR (alist)->contents[index];
@@ -529,6 +530,7 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
     tail = alist;
   else
     {
+      alist = obarray_buckets (alist);
       index = 0;
       obsize = XVECTOR (alist)->size;
       bucket = XVECTOR (alist)->contents[index];
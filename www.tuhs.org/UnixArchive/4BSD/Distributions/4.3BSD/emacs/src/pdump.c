@@ -0,0 +1,1050 @@
+/* Portable dumping of the Lisp state of GNU Emacs.
+   Copyright (C) 1985 Richard M. Stallman.
+
+This file is part of GNU Emacs.
+
+GNU Emacs is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY.  No author or distributor
+accepts responsibility to anyone for the consequences of using it
+or for whether it serves any particular purpose or works at all,
+unless he says so in writing.  Refer to the GNU Emacs General Public
+License for full details.
+
+Everyone is granted permission to copy, modify and redistribute
+GNU Emacs, but only under the conditions described in the
+GNU Emacs General Public License.   A copy of this license is
+supposed to have been given to you along with GNU Emacs so you
+can know your rights and responsibilities.  It should be in a
+file named COPYING.  Among other things, the copyright notice
+and this notice must be preserved on all copies.  */
+
+
+/* dump-emacs writes out the whole executable with unexec, which must
+ know the format of executable files and needs the program to be
+ loaded at the same address each time.  dump-emacs-portable instead
+ writes the Lisp objects themselves to a file, and  emacs -pdump FILE
+ rebuilds them at startup, after making the standard symbols
+ just as temacs does.
+
+ The file holds a header; then the roots: the values of the variables
+ in staticvec, and the symbols interned in the obarray; then a record
+ for each impure object reachable from the roots; then relocations
+ for the pure objects; then, starting on a page boundary, an image
+ of pure storage.  Objects refer to each other by number, the index
+ of their record.  Each reference is two words: DUMP_RAW and a
+ Lisp_Object that holds no pointer, DUMP_REF and the number of an
+ object, or DUMP_PURE and a pointer into the image.
+
+ The image is mapped copy-on-write as the pure storage of the new
+ Emacs, so processes started from the same file share its pages.
+ A relocation gives the offset in the image of a slot of a pure
+ object, and a reference to store there.  Slots referring to other
+ pure objects need changing only if pure storage is not at the
+ same address as when the dump was made.
+
+ A root that holds buffers, windows or processes, such as the list
+ of buffers, is left with the value it gets at startup.
+
+ Symbols are found again by name, and built-in functions by the name
+ they were defined with, so nothing in the file depends on where
+ the program or its data are loaded.  Buffers, windows, markers and
+ processes are made anew at each startup and are not dumped;
+ a reference to one becomes nil.  */
+
+#include "config.h"
+#include "lisp.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
+
+#define DUMP_MAGIC "GNUEmacs"
+#define DUMP_VERSION 2
+
+/* Checks the byte order */
+#define DUMP_BYTE_ORDER 0x01020304
+
+/* Kinds of reference */
+#define DUMP_RAW 0
+#define DUMP_REF 1
+#define DUMP_PURE 2
+#define DUMP_KEEP 3		/* Root left as the new Emacs sets it up */
+
+/* Kinds of record.  DUMP_INTERNED may be added to DUMP_SYMBOL.  */
+#define DUMP_CONS 1
+#define DUMP_STRING 2
+#define DUMP_VECTOR 3
+#define DUMP_SYMBOL 4
+#define DUMP_SUBR 5
+#define DUMP_HASH_TABLE 6
+#define DUMP_OBARRAY 7		/* The standard obarray */
+#define DUMP_UNBOUND 8		/* The symbol Qunbound */
+#define DUMP_TYPE 0377
+#define DUMP_INTERNED 0400
+
+/* How a symbol's value is to be restored */
+#define DUMP_VAL_PLAIN 0	/* Store it in the value cell */
+#define DUMP_VAL_SET 1		/* Set the C variable it forwards to */
+#define DUMP_VAL_DEFAULT 2	/* Set its default value */
+#define DUMP_VAL_AUTO_LOCAL 3	/* Likewise, and make it buffer-local */
+#define DUMP_VAL_SKIP 4		/* Per-buffer; leave it alone */
+
+/* The image of pure storage starts at a multiple of this in the file,
+ which must be a multiple of the page size.  */
+#define DUMP_PAGE (1 << 16)
+
+/* Number of words in the header, after the magic number */
+#define DUMP_HEADER_WORDS 11
+
+#define WORDS(nbytes) (((nbytes) + sizeof (LISP_WORD) - 1) / sizeof (LISP_WORD))
+
+/* Nonzero if `obj' is in the part of pure storage that is dumped.
+ Unlike PURE_P, this is false of data that unexec would make pure.  */
+#define IN_PURE_IMAGE(obj) \
+  (XUINT (obj) < (unsigned LISP_WORD) (pure_base + pureptr) \
+   && XUINT (obj) >= (unsigned LISP_WORD) pure_base)
+
+extern char staticvec1[];
+extern int staticidx;
+#define staticvec ((Lisp_Object **) staticvec1)
+
+extern int pureptr;
+extern Lisp_Object Vobarray, initial_obarray, Qunbound;
+extern Lisp_Object oblookup (), do_symval_forwarding ();
+
+/* Writing a dump.  */
+
+#define UNDUMPABLE(obj) \
+  (XTYPE (obj) == Lisp_Buffer || XTYPE (obj) == Lisp_Window \
+   || XTYPE (obj) == Lisp_Process || XTYPE (obj) == Lisp_Marker)
+
+/* The output accumulates here.  */
+static char *dump_buf;
+static int dump_buf_size, dump_fill;
+
+/* The objects found so far, in the order they were found,
+ and an open hash table of their indices plus one, keyed by address.
+ dump_numbers holds the number of each impure object, or -1
+ for a pure one, which has no record.  */
+static Lisp_Object *dump_objects;
+static int *dump_numbers;
+static int dump_nobjects, dump_objects_size, dump_nrecords;
+static int *dump_index;
+static int dump_index_size;
+
+/* The relocations for pure storage, three words each */
+static LISP_WORD *dump_relocs;
+static int dump_nrelocs, dump_relocs_size;
+
+/* Number of interned symbols written among the roots */
+static int dump_nsymbols;
+
+static void dump_ref ();
+
+static void
+dump_bytes (ptr, nbytes)
+     char *ptr;
+     int nbytes;
+{
+  if (dump_fill + nbytes > dump_buf_size)
+    {
+      while (dump_fill + nbytes > dump_buf_size)
+	dump_buf_size *= 2;
+      dump_buf = (char *) realloc (dump_buf, dump_buf_size);
+      if (!dump_buf) memory_full ();
+    }
+  bcopy (ptr, dump_buf + dump_fill, nbytes);
+  dump_fill += nbytes;
+}
+
+static void
+dump_word (w)
+     LISP_WORD w;
+{
+  dump_bytes ((char *) &w, sizeof w);
+}
+
+/* Write the size and then the chars of a string,
+ padded with at least one null to a whole number of words.  */
+
+static void
+dump_string (ptr, size)
+     char *ptr;
+     int size;
+{
+  static char zeros[sizeof (LISP_WORD)];
+
+  dump_word (size);
+  dump_bytes (ptr, size);
+  dump_bytes (zeros, WORDS (size + 1) * sizeof (LISP_WORD) - size);
+}
+
+static int
+dump_hash (obj)
+     Lisp_Object obj;
+{
+  return (int) ((unsigned LISP_WORD) XUINT (obj) / sizeof (LISP_WORD)
+		* 2654435761U) & (dump_index_size - 1);
+}
+
+/* Return the index of `obj' in dump_objects, adding it if it is not there.  */
+
+static int
+dump_object_index (obj)
+     Lisp_Object obj;
+{
+  register int h, i;
+
+  for (h = dump_hash (obj); (i = dump_index[h]); h = (h + 1) & (dump_index_size - 1))
+    if (EQ (dump_objects[i - 1], obj))
+      return i - 1;
+
+  if (dump_nobjects == dump_objects_size)
+    {
+      dump_objects_size *= 2;
+      dump_objects = (Lisp_Object *) realloc (dump_objects,
+					       dump_objects_size * sizeof (Lisp_Object));
+      dump_numbers = (int *) realloc (dump_numbers,
+				      dump_objects_size * sizeof (int));
+      if (!dump_objects || !dump_numbers) memory_full ();
+    }
+  dump_objects[dump_nobjects] = obj;
+  dump_numbers[dump_nobjects] = IN_PURE_IMAGE (obj) ? -1 : dump_nrecords++;
+  dump_index[h] = ++dump_nobjects;
+
+  /* Keep the hash table at most half full.  */
+  if (2 * dump_nobjects > dump_index_size)
+    {
+      free (dump_index);
+      dump_index_size *= 2;
+      dump_index = (int *) malloc (dump_index_size * sizeof (int));
+      if (!dump_index) memory_full ();
+      bzero (dump_index, dump_index_size * sizeof (int));
+      for (i = 0; i < dump_nobjects; i++)
+	{
+	  for (h = dump_hash (dump_objects[i]); dump_index[h];
+	       h = (h + 1) & (dump_index_size - 1));
+	  dump_index[h] = i + 1;
+	}
+    }
+  return dump_nobjects - 1;
+}
+
+/* Return the kind of reference to write for `obj',
+ and store in `*valp' the word to write with it.  */
+
+static int
+dump_ref_kind (obj, valp)
+     Lisp_Object obj;
+     LISP_WORD *valp;
+{
+#ifdef SWITCH_ENUM_BUG
+  switch ((int) XTYPE (obj))
+#else
+  switch (XTYPE (obj))
+#endif
+    {
+    case Lisp_String:
+    case Lisp_Vector:
+    case Lisp_Cons:
+      if (IN_PURE_IMAGE (obj))
+	{
+	  /* The slots of a pure cons or vector may need relocating;
+	     a string has nothing in it to relocate.  */
+	  if (XTYPE (obj) != Lisp_String)
+	    dump_object_index (obj);
+	  *valp = obj;
+	  return DUMP_PURE;
+	}
+    case Lisp_Symbol:
+    case Lisp_Subr:
+    case Lisp_Hash_Table:
+      *valp = dump_numbers[dump_object_index (obj)];
+      return DUMP_REF;
+
+    case Lisp_Marker:
+    case Lisp_Buffer:
+    case Lisp_Window:
+    case Lisp_Process:
+    case Lisp_Temp_Vector:
+      *valp = Qnil;
+      return DUMP_RAW;
+
+    default:
+      *valp = obj;
+      return DUMP_RAW;
+    }
+}
+
+static void
+dump_ref (obj)
+     Lisp_Object obj;
+{
+  LISP_WORD val;
+
+  dump_word (dump_ref_kind (obj, &val));
+  dump_word (val);
+}
+
+/* Record a relocation for `slot', a slot of a pure object,
+ unless it holds something that can be left as it is.  */
+
+static void
+dump_reloc (slot)
+     Lisp_Object *slot;
+{
+  LISP_WORD val;
+  int kind = dump_ref_kind (*slot, &val);
+
+  if (kind == DUMP_RAW && val == *slot)
+    return;
+  if (dump_nrelocs == dump_relocs_size)
+    {
+      dump_relocs_size *= 2;
+      dump_relocs = (LISP_WORD *) realloc (dump_relocs,
+					   3 * dump_relocs_size * sizeof (LISP_WORD));
+      if (!dump_relocs) memory_full ();
+    }
+  dump_relocs[3 * dump_nrelocs] = (char *) slot - pure_base;
+  dump_relocs[3 * dump_nrelocs + 1] = kind;
+  dump_relocs[3 * dump_nrelocs + 2] = val;
+  dump_nrelocs++;
+}
+
+/* Nonzero if `obj' is an object that is not dumped,
+ or a list of them or of conses whose cdrs are such objects.  */
+
+static int
+editor_state_p (obj)
+     Lisp_Object obj;
+{
+  register Lisp_Object tail, elt;
+
+  if (UNDUMPABLE (obj))
+    return 1;
+  for (tail = obj; LISTP (tail); tail = XCONS (tail)->cdr)
+    {
+      elt = XCONS (tail)->car;
+      if (LISTP (elt))
+	elt = XCONS (elt)->cdr;
+      if (UNDUMPABLE (elt))
+	return 1;
+    }
+  return 0;
+}
+
+static
+dump_interned_symbol (sym, arg)
+     Lisp_Object sym, arg;
+{
+  dump_ref (sym);
+  dump_nsymbols++;
+}
+
+static void
+dump_symbol (sym)
+     Lisp_Object sym;
+{
+  register struct Lisp_Symbol *ptr = XSYMBOL (sym);
+  register Lisp_Object valcontents = ptr->value;
+  int interned;
+  Lisp_Object tem;
+
+  if (EQ (sym, Qunbound))
+    {
+      dump_word (DUMP_UNBOUND);
+      return;
+    }
+
+  interned = EQ (oblookup (Vobarray, ptr->name->data, ptr->name->size), sym);
+  dump_word (DUMP_SYMBOL | (interned ? DUMP_INTERNED : 0));
+  dump_string (ptr->name->data, ptr->name->size);
+
+#ifdef SWITCH_ENUM_BUG
+  switch ((int) XTYPE (valcontents))
+#else
+  switch (XTYPE (valcontents))
+#endif
+    {
+    case Lisp_Objfwd:
+    case Lisp_Intfwd:
+    case Lisp_Boolfwd:
+      /* This is Qunbound if the C variable is void.  */
+      dump_word (DUMP_VAL_SET);
+      dump_ref (do_symval_forwarding (valcontents));
+      break;
+
+    case Lisp_Buffer_Local_Value:
+    case Lisp_Some_Buffer_Local_Value:
+      dump_word (XTYPE (valcontents) == Lisp_Buffer_Local_Value
+		 ? DUMP_VAL_AUTO_LOCAL : DUMP_VAL_DEFAULT);
+      dump_ref (Fdefault_value (sym));
+      break;
+
+    case Lisp_Buffer_Objfwd:
+      dump_word (DUMP_VAL_SKIP);
+      dump_ref (Qnil);
+      break;
+
+    default:
+      dump_word (DUMP_VAL_PLAIN);
+      dump_ref (valcontents);
+    }
+  dump_ref (ptr->function);
+  dump_ref (ptr->plist);
+
+  /* An uninterned symbol may be in some other obarray.  */
+  if (!interned && ptr->next)
+    XSET (tem, Lisp_Symbol, ptr->next);
+  else
+    tem = make_number (0);
+  dump_ref (tem);
+}
+
+static void
+dump_record (obj)
+     Lisp_Object obj;
+{
+  register int i;
+
+  if (IN_PURE_IMAGE (obj))
+    {
+      if (XTYPE (obj) == Lisp_Cons)
+	{
+	  dump_reloc (&XCONS (obj)->car);
+	  dump_reloc (&XCONS (obj)->cdr);
+	}
+      else
+	for (i = 0; i < XVECTOR (obj)->size; i++)
+	  dump_reloc (&XVECTOR (obj)->contents[i]);
+      return;
+    }
+
+#ifdef SWITCH_ENUM_BUG
+  switch ((int) XTYPE (obj))
+#else
+  switch (XTYPE (obj))
+#endif
+    {
+    case Lisp_Cons:
+      dump_word (DUMP_CONS);
+      dump_ref (XCONS (obj)->car);
+      dump_ref (XCONS (obj)->cdr);
+      break;
+
+    case Lisp_String:
+      dump_word (DUMP_STRING);
+      dump_string (XSTRING (obj)->data, XSTRING (obj)->size);
+      break;
+
+    case Lisp_Vector:
+      if (EQ (obj, initial_obarray))
+	{
+	  dump_word (DUMP_OBARRAY);
+	  break;
+	}
+      dump_word (DUMP_VECTOR);
+      dump_word (XVECTOR (obj)->size);
+      for (i = 0; i < XVECTOR (obj)->size; i++)
+	dump_ref (XVECTOR (obj)->contents[i]);
+      break;
+
+    case Lisp_Hash_Table:
+      {
+	register struct Lisp_Hash_Table *h = XHASH_TABLE (obj);
+	register struct Lisp_Vector *buckets = XVECTOR (h->buckets);
+	register Lisp_Object tail;
+	int count = 0;
+
+	for (i = 0; i < buckets->size; i++)
+	  for (tail = buckets->contents[i]; LISTP (tail); tail = XCONS (tail)->cdr)
+	    count++;
+	dump_word (DUMP_HASH_TABLE);
+	dump_ref (h->test);
+	dump_ref (h->weak);
+	dump_word (count);
+	for (i = 0; i < buckets->size; i++)
+	  for (tail = buckets->contents[i]; LISTP (tail); tail = XCONS (tail)->cdr)
+	    {
+	      dump_ref (XCONS (XCONS (tail)->car)->car);
+	      dump_ref (XCONS (XCONS (tail)->car)->cdr);
+	    }
+      }
+      break;
+
+    case Lisp_Subr:
+      dump_word (DUMP_SUBR);
+      dump_string (XSUBR (obj)->symbol_name, strlen (XSUBR (obj)->symbol_name));
+      /* Snarf-documentation sets doc to minus the position of the
+	 documentation in the DOC file; save that, but not a pointer.  */
+      dump_word ((LISP_WORD) XSUBR (obj)->doc < 0 ? (LISP_WORD) XSUBR (obj)->doc : 0);
+      break;
+
+    case Lisp_Symbol:
+      dump_symbol (obj);
+      break;
+
+    default:
+      abort ();
+    }
+}
+
+static void
+dump_free ()
+{
+  free (dump_buf);
+  free (dump_objects);
+  free (dump_numbers);
+  free (dump_index);
+  free (dump_relocs);
+}
+
+DEFUN ("dump-emacs-portable", Fdump_emacs_portable, Sdump_emacs_portable, 1, 1, 0,
+  "Dump the Lisp state of Emacs into the file FILENAME.\n\
+Running  emacs -pdump FILENAME  restores this state at startup\n\
+instead of loading the Lisp files again.  Unlike dump-emacs, this\n\
+does not depend on the format of executable files or on where the\n\
+program is loaded.  Buffers, windows, markers and processes\n\
+are not dumped; references to them become nil.")
+  (filename)
+     Lisp_Object filename;
+{
+  register int i, fd;
+  LISP_WORD counts[3];
+  int counts_pos;
+  static char zeros[DUMP_PAGE];
+
+  CHECK_STRING (filename, 0);
+  filename = Fexpand_file_name (filename, Qnil);
+
+  dump_buf_size = 1 << 16;
+  dump_buf = (char *) malloc (dump_buf_size);
+  dump_objects_size = 1 << 12;
+  dump_objects = (Lisp_Object *) malloc (dump_objects_size * sizeof (Lisp_Object));
+  dump_numbers = (int *) malloc (dump_objects_size * sizeof (int));
+  dump_index_size = 1 << 13;
+  dump_index = (int *) malloc (dump_index_size * sizeof (int));
+  dump_relocs_size = 1 << 12;
+  dump_relocs = (LISP_WORD *) malloc (3 * dump_relocs_size * sizeof (LISP_WORD));
+  if (!dump_buf || !dump_objects || !dump_numbers || !dump_index || !dump_relocs)
+    memory_full ();
+  bzero (dump_index, dump_index_size * sizeof (int));
+  dump_fill = 0;
+  dump_nobjects = 0;
+  dump_nrecords = 0;
+  dump_nrelocs = 0;
+  dump_nsymbols = 0;
+
+  dump_bytes (DUMP_MAGIC, sizeof (LISP_WORD) < 8 ? 8 : sizeof (LISP_WORD));
+  dump_word (DUMP_BYTE_ORDER);
+  dump_word (DUMP_VERSION);
+  dump_word (sizeof (LISP_WORD));
+  dump_word (VALBITS);
+  dump_word (staticidx);
+  /* The numbers of records, symbols and relocations go here at the end.  */
+  counts_pos = dump_fill;
+  dump_word (0);
+  dump_word (0);
+  dump_word (0);
+  dump_word ((LISP_WORD) pure_base);
+  dump_word (pureptr);
+  /* The offset of the image of pure storage goes here.  */
+  dump_word (0);
+
+  for (i = 0; i < staticidx; i++)
+    if (editor_state_p (*staticvec[i]))
+      {
+	dump_word (DUMP_KEEP);
+	dump_word (0);
+      }
+    else
+      dump_ref (*staticvec[i]);
+  map_obarray (Vobarray, dump_interned_symbol, Qnil);
+
+  /* Writing each record may find more objects.  */
+  for (i = 0; i < dump_nobjects; i++)
+    dump_record (dump_objects[i]);
+
+  counts[0] = dump_nrecords;
+  counts[1] = dump_nsymbols;
+  counts[2] = dump_nrelocs;
+  bcopy ((char *) counts, dump_buf + counts_pos, sizeof counts);
+
+  dump_bytes ((char *) dump_relocs, 3 * dump_nrelocs * sizeof (LISP_WORD));
+  dump_bytes (zeros, (DUMP_PAGE - dump_fill % DUMP_PAGE) % DUMP_PAGE);
+  counts[0] = dump_fill;
+  bcopy ((char *) counts, dump_buf + counts_pos + 5 * sizeof (LISP_WORD),
+	 sizeof (LISP_WORD));
+  dump_bytes (pure_base, pureptr);
+
+  fd = creat (XSTRING (filename)->data, 0666);
+  if (fd < 0
+      || write (fd, dump_buf, dump_fill) != dump_fill
+      || close (fd) < 0)
+    {
+      if (fd >= 0)
+	close (fd);
+      dump_free ();
+      report_file_error ("Writing dump file", Fcons (filename, Qnil));
+    }
+
+  dump_free ();
+  return Qnil;
+}
+
+/* Loading a dump.  */
+
+/* The contents of the dump file, and their size in words */
+static char *load_data;
+static int load_nwords;
+static LISP_WORD *load_header;
+
+/* The objects made so far, by number */
+static Lisp_Object *load_objects;
+static int load_nobjects;
+
+/* How far pure storage is from where it was when the dump was made */
+static LISP_WORD load_pure_delta;
+
+/* Set by load_ref when a reference is not to any object the dump has */
+static int load_damaged;
+
+static Lisp_Object
+load_ref (p)
+     LISP_WORD *p;
+{
+  Lisp_Object val;
+
+  if (p[0] == DUMP_RAW)
+    return p[1];
+  if (p[0] == DUMP_PURE)
+    {
+      val = p[1];
+      XSETUINT (val, XUINT (val) + load_pure_delta);
+      return val;
+    }
+  if (p[0] != DUMP_REF || p[1] < 0 || p[1] >= load_nobjects)
+    {
+      load_damaged = 1;
+      return Qnil;
+    }
+  return load_objects[p[1]];
+}
+
+/* Return the symbol named by the chars at `ptr', interning it if need be.  */
+
+static Lisp_Object
+load_interned_symbol (ptr, size)
+     char *ptr;
+     int size;
+{
+  Lisp_Object tem;
+
+  tem = oblookup (Vobarray, ptr, size);
+  if (XTYPE (tem) != Lisp_Symbol)
+    tem = Fintern (make_string (ptr, size), Vobarray);
+  return tem;
+}
+
+/* Return the built-in function named `name', and give it the
+ documentation position `doc' if that is nonzero.  The function is
+ still the definition of the symbol of that name, since the
+ definitions have not been loaded yet.  */
+
+static Lisp_Object
+load_subr (name, doc)
+     char *name;
+     LISP_WORD doc;
+{
+  Lisp_Object fn;
+
+  fn = XSYMBOL (intern (name))->function;
+  if (XTYPE (fn) != Lisp_Subr || strcmp (XSUBR (fn)->symbol_name, name))
+    return Qnil;
+  if (doc)
+    XSUBR (fn)->doc = (char *) doc;
+  return fn;
+}
+
+/* Return the address of the record after the one at `p',
+ or 0 if the record at `p' is not a valid one.  */
+
+static LISP_WORD *
+load_next_record (p)
+     register LISP_WORD *p;
+{
+  switch (p[0] & DUMP_TYPE)
+    {
+    case DUMP_CONS:
+      return p + 5;
+    case DUMP_STRING:
+      return p + 2 + WORDS (p[1] + 1);
+    case DUMP_SUBR:
+      return p + 2 + WORDS (p[1] + 1) + 1;
+    case DUMP_VECTOR:
+      return p + 2 + 2 * p[1];
+    case DUMP_HASH_TABLE:
+      return p + 6 + 4 * p[5];
+    case DUMP_SYMBOL:
+      return p + 2 + WORDS (p[1] + 1) + 9;
+    case DUMP_OBARRAY:
+    case DUMP_UNBOUND:
+      return p + 1;
+    }
+  return 0;
+}
+
+/* Make and return the object for the record at `p'.  */
+
+static Lisp_Object
+load_make_object (p)
+     register LISP_WORD *p;
+{
+  register int size = p[1];
+
+  switch (p[0] & DUMP_TYPE)
+    {
+    case DUMP_CONS:
+      return Fcons (Qnil, Qnil);
+
+    case DUMP_STRING:
+      return make_string ((char *) (p + 2), size);
+
+    case DUMP_VECTOR:
+      return Fmake_vector (make_number (size), Qnil);
+
+    case DUMP_HASH_TABLE:
+      return Fmake_hash_table (Qnil, Qnil, make_number (p[5]));
+
+    case DUMP_SUBR:
+      return load_subr ((char *) (p + 2), p[2 + WORDS (size + 1)]);
+
+    case DUMP_SYMBOL:
+      if (p[0] & DUMP_INTERNED)
+	return load_interned_symbol ((char *) (p + 2), size);
+      return Fmake_symbol (make_string ((char *) (p + 2), size));
+
+    case DUMP_OBARRAY:
+      return initial_obarray;
+
+    case DUMP_UNBOUND:
+      return Qunbound;
+    }
+  return Qnil;
+}
+
+/* Restore the value `val' of symbol `sym', of a kind given by `how'.
+ This is done before init_eval and init_data, so it stores into the
+ value cell, or the C variable it forwards to, rather than use Fset.  */
+
+static void
+load_symbol_value (sym, how, val)
+     Lisp_Object sym, val;
+     int how;
+{
+  register Lisp_Object valcontents = XSYMBOL (sym)->value;
+  Lisp_Object tem;
+
+  if (how == DUMP_VAL_SKIP)
+    return;
+
+#ifdef SWITCH_ENUM_BUG
+  switch ((int) XTYPE (valcontents))
+#else
+  switch (XTYPE (valcontents))
+#endif
+    {
+    case Lisp_Intfwd:
+      if (XTYPE (val) == Lisp_Int)
+	*XINTPTR (valcontents) = XINT (val);
+      break;
+
+    case Lisp_Boolfwd:
+      if (!EQ (val, Qunbound))
+	*XINTPTR (valcontents) = !NULL (val);
+      break;
+
+    case Lisp_Objfwd:
+      /* If the variable was void, keep the value it starts with.  */
+      if (!EQ (val, Qunbound))
+	*XOBJFWD (valcontents) = val;
+      break;
+
+    default:
+      XSYMBOL (sym)->value = val;
+    }
+
+  /* This is what make-variable-buffer-local does.  */
+  if (how == DUMP_VAL_AUTO_LOCAL)
+    {
+      if (EQ (XSYMBOL (sym)->value, Qunbound))
+	XSYMBOL (sym)->value = Qnil;
+      note_local_variable (sym, XSYMBOL (sym)->value);
+      tem = Fcons (Qnil, do_symval_forwarding (XSYMBOL (sym)->value));
+      XCONS (tem)->car = tem;
+      XSYMBOL (sym)->value = Fcons (XSYMBOL (sym)->value, Fcons (Fcurrent_buffer (), tem));
+      XSETTYPE (XSYMBOL (sym)->value, Lisp_Buffer_Local_Value);
+    }
+}
+
+/* Fill in the contents of the object `obj' from the record at `p'.  */
+
+static void
+load_fill_object (p, obj)
+     register LISP_WORD *p;
+     Lisp_Object obj;
+{
+  register int i, size;
+  Lisp_Object tem;
+
+  switch (p[0] & DUMP_TYPE)
+    {
+    case DUMP_CONS:
+      XCONS (obj)->car = load_ref (p + 1);
+      XCONS (obj)->cdr = load_ref (p + 3);
+      break;
+
+    case DUMP_VECTOR:
+      size = p[1];
+      for (i = 0; i < size; i++)
+	XVECTOR (obj)->contents[i] = load_ref (p + 2 + 2 * i);
+      break;
+
+    case DUMP_HASH_TABLE:
+      XHASH_TABLE (obj)->test = load_ref (p + 1);
+      XHASH_TABLE (obj)->weak = load_ref (p + 3);
+      break;
+
+    case DUMP_SYMBOL:
+      p += 2 + WORDS (p[1] + 1);
+      load_symbol_value (obj, (int) p[0], load_ref (p + 1));
+      XSYMBOL (obj)->function = load_ref (p + 3);
+      XSYMBOL (obj)->plist = load_ref (p + 5);
+      tem = load_ref (p + 7);
+      if (XTYPE (tem) == Lisp_Symbol)
+	XSYMBOL (obj)->next = XSYMBOL (tem);
+      /* The symbol may be older than what it now points to.  */
+      remember_object (obj);
+      break;
+    }
+}
+
+/* Put the entries into the hash table `obj' from the record at `p'.
+ This must wait until all the keys are complete, since an equal
+ hash table hashes the contents of its keys.  */
+
+static void
+load_hash_entries (p, obj)
+     register LISP_WORD *p;
+     Lisp_Object obj;
+{
+  register int i;
+
+  for (i = 0; i < p[5]; i++)
+    Fputhash (load_ref (p + 6 + 4 * i), load_ref (p + 8 + 4 * i), obj);
+}
+
+/* Read the dump file `filename', and make its image the contents
+ of pure storage.  This must be done before anything is put
+ in pure storage, and before load_portable_dump is called.
+ Return 0 if successful, or else a message saying what was wrong.  */
+
+char *
+map_portable_dump (filename)
+     char *filename;
+{
+  int fd, i;
+  struct stat st;
+  register LISP_WORD *header;
+  char *msg = 0;
+
+  fd = open (filename, O_RDONLY, 0);
+  if (fd < 0)
+    return "cannot open dump file";
+  if (fstat (fd, &st) < 0)
+    {
+      close (fd);
+      return "cannot read dump file";
+    }
+
+#ifdef HAVE_MMAP
+  load_data = (char *) mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (load_data == (char *) -1)
+    {
+      close (fd);
+      return "cannot map dump file";
+    }
+#else /* not HAVE_MMAP */
+  load_data = (char *) malloc (st.st_size);
+  if (!load_data || read (fd, load_data, st.st_size) != st.st_size)
+    {
+      if (load_data) free (load_data);
+      close (fd);
+      return "cannot read dump file";
+    }
+#endif /* not HAVE_MMAP */
+  load_nwords = st.st_size / sizeof (LISP_WORD);
+
+  i = WORDS (sizeof (LISP_WORD) < 8 ? 8 : sizeof (LISP_WORD));
+  load_header = header = (LISP_WORD *) load_data + i;
+  if (load_nwords < i + DUMP_HEADER_WORDS
+      || strncmp (load_data, DUMP_MAGIC, 8)
+      || header[0] != DUMP_BYTE_ORDER
+      || header[1] != DUMP_VERSION
+      || header[2] != sizeof (LISP_WORD)
+      || header[3] != VALBITS)
+    msg = "not a dump file for this kind of machine";
+  else if (header[4] != staticidx)
+    msg = "dump file was made by a different Emacs";
+  else if (header[10] + header[9] > st.st_size)
+    msg = "dump file is damaged";
+  else if (map_pure_file (fd, (long) header[10], (int) header[9]) < 0)
+    msg = "cannot make pure storage from dump file";
+  close (fd);
+
+  if (msg)
+    {
+#ifdef HAVE_MMAP
+      munmap (load_data, st.st_size);
+#else
+      free (load_data);
+#endif
+      load_data = 0;
+    }
+  return msg;
+}
+
+/* Restore the rest of the Lisp state from the dump file that
+ map_portable_dump read.  The standard symbols must have been made.
+ Return 0 if successful, or else a message saying what was wrong.  */
+
+char *
+load_portable_dump ()
+{
+  int nsymbols, nrelocs;
+  register LISP_WORD *p, *header = load_header, *roots, *end;
+  register int i, pass;
+  char *msg = 0;
+
+  load_nobjects = header[5];
+  load_damaged = 0;
+  nsymbols = header[6];
+  nrelocs = header[7];
+  load_pure_delta = pure_base - (char *) header[8];
+  roots = header + DUMP_HEADER_WORDS;
+  end = (LISP_WORD *) load_data + load_nwords;
+  load_objects = (Lisp_Object *) malloc ((load_nobjects + 1) * sizeof (Lisp_Object));
+  if (!load_objects)
+    {
+      msg = "not enough memory to load dump file";
+      goto done;
+    }
+
+  /* Pass 0 makes the objects; pass 1 fills them in, now that any of
+     them can be referred to; pass 2 fills the hash tables.  */
+  for (pass = 0; pass < 3; pass++)
+    {
+      p = roots + 2 * (staticidx + nsymbols);
+      for (i = 0; i < load_nobjects; i++)
+	{
+	  register LISP_WORD *next;
+
+	  if (p >= end
+	      || !(next = load_next_record (p))
+	      || next > end)
+	    {
+	      msg = "dump file is damaged";
+	      goto done;
+	    }
+	  if (pass == 0)
+	    load_objects[i] = load_make_object (p);
+	  else if (pass == 1)
+	    load_fill_object (p, load_objects[i]);
+	  else if (pass == 2 && (p[0] & DUMP_TYPE) == DUMP_HASH_TABLE)
+	    load_hash_entries (p, load_objects[i]);
+	  if (load_damaged)
+	    {
+	      msg = "dump file is damaged";
+	      goto done;
+	    }
+	  p = next;
+	}
+
+      /* After pass 0, make the pure objects refer to the new ones.
+	 This changes only the pages of the image that have such slots.  */
+      if (pass == 0)
+	{
+	  if (p + 3 * nrelocs > end)
+	    {
+	      msg = "dump file is damaged";
+	      goto done;
+	    }
+	  for (i = 0; i < nrelocs; i++, p += 3)
+	    {
+	      if (p[0] < 0 || p[0] >= pureptr)
+		{
+		  msg = "dump file is damaged";
+		  goto done;
+		}
+	      if (p[1] != DUMP_PURE || load_pure_delta)
+		*(Lisp_Object *) (pure_base + p[0]) = load_ref (p + 1);
+	      if (load_damaged)
+		{
+		  msg = "dump file is damaged";
+		  goto done;
+		}
+	    }
+	}
+    }
+
+  /* A vector such as the standard syntax table is already referred to
+     by the buffers made at startup, so update it rather than replace it.  */
+  for (i = 0; i < staticidx; i++)
+    {
+      register Lisp_Object *var = staticvec[i];
+      Lisp_Object val;
+
+      if (roots[2 * i] == DUMP_KEEP)
+	continue;
+      val = load_ref (roots + 2 * i);
+      if (load_damaged)
+	{
+	  msg = "dump file is damaged";
+	  goto done;
+	}
+      if (XTYPE (*var) == Lisp_Vector && XTYPE (val) == Lisp_Vector
+	  && !PURE_P (*var) && !EQ (*var, initial_obarray)
+	  && XVECTOR (*var)->size == XVECTOR (val)->size)
+	{
+	  bcopy ((char *) XVECTOR (val)->contents, (char *) XVECTOR (*var)->contents,
+		 XVECTOR (val)->size * sizeof (Lisp_Object));
+	  remember_object (*var);
+	}
+      else
+	*var = val;
+    }
+
+  Vpurify_flag = Qnil;
+  /* Every symbol has a new function definition */
+  function_generation++;
+
+ done:
+  if (load_objects)
+    free (load_objects);
+  load_objects = 0;
+#ifdef HAVE_MMAP
+  munmap (load_data, load_nwords * sizeof (LISP_WORD));
+#else
+  free (load_data);
+#endif
+  load_data = 0;
+  return msg;
+}
+
+syms_of_pdump ()
+{
+  defsubr (&Sdump_emacs_portable);
+}
@@ -52,6 +52,8 @@ extern int noninteractive_need_newline;
  and must start with PRINTPREPARE and end with PRINTFINISH.
  Use PRINTCHAR to output one character,
  or call strout to output a block of characters.
+ Output into a buffer is collected in print_buffer
+ and inserted a block at a time; PRINTFINISH inserts the rest.
  Also, each one must have the declarations
    struct buffer *old = bf_cur;
    int old_point = -1, start_point;
@@ -70,9 +72,14 @@ extern int noninteractive_need_newline;
        old_point = point; \
        SetPoint (marker_position (printcharfun)); \
        start_point = point; \
-       printcharfun = Qnil;}
+       printcharfun = Qnil;} \
+   print_buffer_pos = 0; \
+   if (EQ (printcharfun, Qnil)) \
+     prepare_to_modify_buffer ()
 
 #define PRINTFINISH \
+   if (EQ (printcharfun, Qnil)) \
+     print_flush (); \
    if (XTYPE (original) == Lisp_Marker) \
      Fset_marker (original, make_number (point), Qnil); \
    if (old_point >= 0) \
@@ -87,6 +94,43 @@ static char printbuf[MScreenWidth + 1];
 /* Index of first unused element of above */
 static int printbufidx;
 
+/* Output destined for a buffer, not yet inserted.
+ No Lisp code runs between putting output here and inserting it,
+ so one such buffer serves all the printing in progress.
+ PRINTPREPARE calls prepare_to_modify_buffer before any output is
+ collected, to ask about the file lock then; and print_flush takes
+ the output out before inserting it, in case inserting runs Lisp
+ code that prints.  */
+static char *print_buffer;
+static int print_buffer_size;
+/* Index of first unused element of above */
+static int print_buffer_pos;
+
+/* Insert the output collected in print_buffer in the current buffer.
+ This makes one undo record for all of it.  */
+
+static void
+print_flush ()
+{
+  register int len = print_buffer_pos;
+  register char *text;
+
+  if (len > 0)
+    {
+      text = (char *) alloca (len);
+      bcopy (print_buffer, text, len);
+      print_buffer_pos = 0;
+      InsCStr (text, len);
+    }
+}
+
+/* Use this instead of QUIT, and call print_flush before signaling
+ an error, so that output already done is not lost by a nonlocal exit.  */
+
+#define PRINT_QUIT \
+  { if (!NULL (Vquit_flag) && NULL (Vinhibit_quit)) print_flush (); \
+    QUIT; }
+
 static void
 printchar (ch, fun)
      unsigned char ch;
@@ -97,8 +141,10 @@ printchar (ch, fun)
 #ifndef standalone
   if (EQ (fun, Qnil))
     {
-      QUIT;
-      InsCStr (&ch, 1);
+      PRINT_QUIT;
+      if (print_buffer_pos == print_buffer_size)
+	print_flush ();
+      print_buffer[print_buffer_pos++] = ch;
       return;
     }
   if (EQ (fun, Qt))
@@ -132,7 +178,16 @@ strout (ptr, size, printcharfun)
 
   if (EQ (printcharfun, Qnil))
     {
-      InsCStr (ptr, size >= 0 ? size : strlen (ptr));
+      i = size >= 0 ? size : strlen (ptr);
+      if (i > print_buffer_size - print_buffer_pos)
+	print_flush ();
+      if (i > print_buffer_size)
+	InsCStr (ptr, i);
+      else
+	{
+	  bcopy (ptr, &print_buffer[print_buffer_pos], i);
+	  print_buffer_pos += i;
+	}
       return;
     }
   if (EQ (printcharfun, Qt))
@@ -406,11 +461,14 @@ print (obj, printcharfun, escapeflag)
 {
   char buf[30];
 
-  QUIT;
+  PRINT_QUIT;
 
   print_depth++;
   if (print_depth > 200)
-    error ("Apparently circular structure being printed");
+    {
+      print_flush ();
+      error ("Apparently circular structure being printed");
+    }
 
 #ifdef SWITCH_ENUM_BUG
   switch ((int) XTYPE (obj))
@@ -419,7 +477,7 @@ print (obj, printcharfun, escapeflag)
 #endif
     {
     case Lisp_Int:
-      sprintf (buf, "%d", XINT (obj));
+      sprintf (buf, "%ld", (long) XINT (obj));
       strout (buf, -1, printcharfun);
       break;
 
@@ -435,7 +493,7 @@ print (obj, printcharfun, escapeflag)
 	  PRINTCHAR ('\"');
 	  for (i = XSTRING (obj)->size; i > 0; i--)
 	    {
-	      QUIT;
+	      PRINT_QUIT;
 	      c = *p++;
 	      if (c == '\"' || c == '\\')
 		PRINTCHAR ('\\');
@@ -465,7 +523,7 @@ print (obj, printcharfun, escapeflag)
 	p = XSYMBOL (obj)->name->data;
 	while (p != end)
 	  {
-	    QUIT;
+	    PRINT_QUIT;
 	    c = *p++;
 	    if (escapeflag)
 	      {
@@ -550,7 +608,7 @@ print (obj, printcharfun, escapeflag)
 
     case Lisp_Window:
       strout ("#<window ", -1, printcharfun);
-      sprintf (buf, "%d", XFASTINT (XWINDOW (obj)->sequence_number));
+      sprintf (buf, "%ld", (long) XFASTINT (XWINDOW (obj)->sequence_number));
       strout (buf, -1, printcharfun);
       if (!NULL (XWINDOW (obj)->buffer))
 	{
@@ -561,6 +619,16 @@ print (obj, printcharfun, escapeflag)
       PRINTCHAR ('>');
       break;
 
+    case Lisp_Hash_Table:
+      strout ("#<hash-table ", -1, printcharfun);
+      strout (XSYMBOL (XHASH_TABLE (obj)->test)->name->data, -1, printcharfun);
+      if (!NULL (XHASH_TABLE (obj)->weak))
+	strout (" weak", -1, printcharfun);
+      sprintf (buf, " %ld/%d>", (long) XFASTINT (XHASH_TABLE (obj)->count),
+	       XVECTOR (XHASH_TABLE (obj)->buckets)->size);
+      strout (buf, -1, printcharfun);
+      break;
+
     case Lisp_Marker:
       strout ("#<marker ", -1, printcharfun);
       if (!(XMARKER (obj)->buffer))
@@ -604,6 +672,9 @@ or the symbol t (output appears in the minibuffer line).");
 `nil' means no limit.");
   Vprint_length = Qnil;
 
+  print_buffer_size = 1000;
+  print_buffer = (char *) xmalloc (print_buffer_size);
+
   /* prin1_to_string_buffer initialized in init_buffer_once in buffer.c */
   staticpro (&Vprin1_to_string_buffer);
 
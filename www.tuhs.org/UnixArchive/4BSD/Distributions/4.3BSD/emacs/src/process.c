@@ -170,6 +170,51 @@ Lisp_Object get_process ();
    Always -1 on systems that support FIONREAD.  */
 
 int proc_buffered_char[MAXDESC];
+
+/* Redisplay to show process output is done at most once
+   in this many milliseconds.  Zero means redisplay after every read.
+   Redisplay for keyboard input is not affected.  */
+
+int process_redisplay_interval;
+
+/* get_real_usecs () as of the last redisplay for process output.  */
+
+static long last_process_redisplay;
+
+/* Characters of process output read, redisplays done to show them,
+   and redisplays put off by process_redisplay_interval.
+   Reported by process-output-statistics.  */
+
+static int process_output_chars;
+static int process_output_redisplays;
+static int process_output_deferrals;
+
+/* Return how many microseconds must still pass before
+   another redisplay for process output is allowed.  */
+
+static long
+process_redisplay_wait ()
+{
+  extern long get_real_usecs ();
+  long elapsed = get_real_usecs () - last_process_redisplay;
+
+  /* A negative value means the clock was set back.  */
+  if (elapsed < 0)
+    return 0;
+  return process_redisplay_interval * 1000 - elapsed;
+}
+
+/* Redisplay to show process output.  */
+
+static
+process_redisplay ()
+{
+  extern long get_real_usecs ();
+
+  process_output_redisplays++;
+  DoDsp (1);
+  last_process_redisplay = get_real_usecs ();
+}
 
 #ifdef HAVE_PTYS
 
@@ -249,6 +294,7 @@ make_process (name)
 				   / sizeof (Lisp_Object)),
 		      Qnil);
   XSETTYPE (val, Lisp_Process);
+  remember_always (val);
 
   p = XPROCESS (val);
   XFASTINT (p->infd) = 0;
@@ -579,7 +625,7 @@ Proc         Status   Buffer         Command\n\
 	  write_string ("Exit", -1);
 	  if (XFASTINT (p->reason))
 	    {
-	      sprintf (tembuf, " %d", XFASTINT (p->reason));
+	      sprintf (tembuf, " %ld", (long) XFASTINT (p->reason));
 	      write_string (tembuf, -1);
 	    }
 	  remove_process (proc);
@@ -915,6 +961,12 @@ wait_reading_process_input (time_limit, read_kbd, do_display)
 #endif /* not HAVE_TIMEVAL */
   int Atemp;
   int wait_channel = 0;
+  int nread;
+  /* Nonzero if process output has been read but not yet displayed.  */
+  int display_deferred = 0;
+  /* Nonzero if the timeout was shortened to do that display.  */
+  int timeout_shortened;
+  long wait;
   extern kbd_count;
 
   if (read_kbd > 10)
@@ -1006,6 +1058,39 @@ wait_reading_process_input (time_limit, read_kbd, do_display)
 #endif /* not HAVE_TIMEVAL */
 	}
 
+      /* If output is waiting to be displayed, do it when it is due,
+	 and don't sleep past then.  */
+      timeout_shortened = 0;
+      if (display_deferred)
+	{
+	  wait = process_redisplay_wait ();
+	  if (wait <= 0)
+	    {
+	      process_redisplay ();
+	      display_deferred = 0;
+	    }
+	  else
+	    {
+#ifdef HAVE_TIMEVAL
+	      if (timeout.tv_sec > wait / 1000000
+		  || (timeout.tv_sec == wait / 1000000
+		      && timeout.tv_usec > wait % 1000000))
+		{
+		  timeout.tv_sec = wait / 1000000;
+		  timeout.tv_usec = wait % 1000000;
+		  timeout_shortened = 1;
+		}
+#else /* not HAVE_TIMEVAL */
+	      /* Can't wait less than a second; do the best we can.  */
+	      if (timeout > 1)
+		{
+		  timeout = 1;
+		  timeout_shortened = 1;
+		}
+#endif /* not HAVE_TIMEVAL */
+	    }
+	}
+
       /* Cause C-g and alarm signals to take immediate action,
 	 and cause input available signals to zero out timeout */
       if (read_kbd < 0)
@@ -1028,6 +1113,12 @@ wait_reading_process_input (time_limit, read_kbd, do_display)
       /* Make C-g and alarm signals set flags again */
       clear_waiting_for_input ();
 
+      /* If we woke up only to display, go back and do it.
+	 nfds is also 0 when keyboard input was already pending
+	 and we did not wait at all; that input comes first.  */
+      if (timeout_shortened && nfds == 0 && !(read_kbd && kbd_count))
+	continue;
+
       if (time_limit && nfds == 0)	/* timeout elapsed */
 	break;
       if (nfds < 0)
@@ -1101,10 +1192,21 @@ wait_reading_process_input (time_limit, read_kbd, do_display)
 	      /* Read data from the process, starting with our
 		 buffered-ahead character if we have one.  */
 
-	      if (read_process_output (proc, channel) > 0)
+	      if ((nread = read_process_output (proc, channel)) > 0)
 		{
-		  if (do_display)
-		    DoDsp (1);
+		  process_output_chars += nread;
+		  if (do_display
+		      && (process_redisplay_interval <= 0
+			  || process_redisplay_wait () <= 0))
+		    {
+		      process_redisplay ();
+		      display_deferred = 0;
+		    }
+		  else if (do_display && !display_deferred)
+		    {
+		      process_output_deferrals++;
+		      display_deferred = 1;
+		    }
 		}
 	      else
 		{
@@ -1133,6 +1235,12 @@ wait_reading_process_input (time_limit, read_kbd, do_display)
 	    }
 	} /* end for */
     } /* end while */
+
+  /* Show any output whose display was put off,
+     unless the user has typed something;
+     then the command loop will redisplay soon anyway.  */
+  if (display_deferred && !detect_input_pending ())
+    process_redisplay ();
 }
 
 /* Read pending output from the process channel,
@@ -1726,6 +1834,20 @@ exec_sentinel (proc, reason)
   p->sentinel = sentinel;
 }
 
+DEFUN ("process-output-statistics", Fprocess_output_statistics,
+  Sprocess_output_statistics, 0, 0, 0,
+  "Return a list (CHARS REDISPLAYS DEFERRED) about subprocess output.\n\
+CHARS is the number of characters of output read from subprocesses,\n\
+REDISPLAYS the number of redisplays done to show it, and DEFERRED\n\
+the number of times redisplay was put off because of\n\
+process-redisplay-interval.")
+  ()
+{
+  return Fcons (make_number (process_output_chars),
+		Fcons (make_number (process_output_redisplays),
+		       Fcons (make_number (process_output_deferrals), Qnil)));
+}
+
 init_process ()
 {
   register int i;
@@ -1756,6 +1878,13 @@ nil means don't delete them until list-processes is done.");
 
   delete_exited_processes = 1;
 
+  DefIntVar ("process-redisplay-interval", &process_redisplay_interval,
+    "*Minimum milliseconds between redisplays to show subprocess output.\n\
+Output arriving sooner is shown when the interval is up.\n\
+Zero means redisplay after each batch of output is read.");
+
+  process_redisplay_interval = 33;
+
   defsubr (&Sprocessp);
   defsubr (&Sget_process);
   defsubr (&Sget_buffer_process);
@@ -1783,6 +1912,7 @@ nil means don't delete them until list-processes is done.");
   defsubr (&Sstop_process);
   defsubr (&Scontinue_process);
   defsubr (&Sprocess_send_eof);
+  defsubr (&Sprocess_output_statistics);
 }
 
 #endif subprocesses
@@ -176,6 +176,21 @@ matched by parenthesis constructs in the pattern.")
   return make_number (val);
 }
 
+/* Return nonzero if the `size' chars at `text' contain a match for `regexp'.
+ This searches text that is in neither a string nor a buffer,
+ and sets no match data.  */
+
+int
+search_chars (regexp, text, size)
+     Lisp_Object regexp;
+     char *text;
+     int size;
+{
+  compile_pattern (regexp, &searchbuf,
+		   !NULL (bf_cur->case_fold_search) ? (char *) downcase_table : 0);
+  return re_search (&searchbuf, text, size, 0, size, 0) >= 0;
+}
+
 DEFUN ("scan-buffer", Fscan_buffer, Sscan_buffer, 3, 3, 0,
   "Scan from character number FROM for COUNT occurrences of character C.\n\
 Returns the character number of the position after the character found.\n\
@@ -885,15 +900,43 @@ Zero means the entire text matched by the whole regexp.")
   return make_number (search_regs.end[n] + 1);
 }
 
-DEFUN ("match-data", Fmatch_data, Smatch_data, 0, 0, 0,
+/* Convert between the positions in search_regs, which are -1 for a
+ group that did not match, and those in an integer match-data vector.  */
+
+#define MATCH_DATA_POS(reg) ((reg) < 0 ? -1 : (reg) + 1)
+#define MATCH_DATA_REG(pos) ((pos) < 0 ? -1 : (pos) - 1)
+
+DEFUN ("match-data", Fmatch_data, Smatch_data, 0, 1, 0,
   "Return list containing all info on what the last search matched.\n\
 Element 2N is (match-beginning N); element 2N + 1 is (match-end N).\n\
-All are represented as markers.")
-  ()
+All are represented as markers.\n\
+If VECTOR is non-nil, return instead a vector of the same elements\n\
+as integers, which makes no markers.  If VECTOR is a vector of the\n\
+right length it is filled in and returned, so that code which saves\n\
+and restores the match data often can use one vector over and over.\n\
+Integers are not relocated by later changes to the buffer.\n\
+A group that did not match is -1 in the vector.")
+  (vector)
+     Lisp_Object vector;
 {
   Lisp_Object data[2 * RE_NREGS];
+  register Lisp_Object *v;
   int i;
 
+  if (!NULL (vector))
+    {
+      if (XTYPE (vector) != Lisp_Vector
+	  || XVECTOR (vector)->size != 2 * RE_NREGS)
+	vector = Fmake_vector (make_number (2 * RE_NREGS), Qnil);
+      v = XVECTOR (vector)->contents;
+      for (i = 0; i < RE_NREGS; i++)
+	{
+	  XSET (v[2 * i], Lisp_Int, MATCH_DATA_POS (search_regs.start[i]));
+	  XSET (v[2 * i + 1], Lisp_Int, MATCH_DATA_POS (search_regs.end[i]));
+	}
+      return vector;
+    }
+
   for (i = 0; i < RE_NREGS; i++)
     {
       data[2 * i] = Fmake_marker ();
@@ -908,26 +951,44 @@ All are represented as markers.")
 
 DEFUN ("store-match-data", Fstore_match_data, Sstore_match_data, 1, 1, 0,
   "Set internal data on last search match from elements of LIST.\n\
-LIST should have been created by calling match-data previously.")
+LIST should have been created by calling match-data previously.\n\
+It may be a list or a vector, of markers or integers.")
   (list)
      register Lisp_Object list;
 {
   register int i;
   register Lisp_Object marker;
 
+  if (XTYPE (list) == Lisp_Vector)
+    {
+      if (XVECTOR (list)->size != 2 * RE_NREGS)
+	args_out_of_range (list, make_number (XVECTOR (list)->size));
+      for (i = 0; i < RE_NREGS; i++)
+	{
+	  marker = XVECTOR (list)->contents[2 * i];
+	  CHECK_NUMBER_COERCE_MARKER (marker, 0);
+	  search_regs.start[i] = MATCH_DATA_REG (XINT (marker));
+
+	  marker = XVECTOR (list)->contents[2 * i + 1];
+	  CHECK_NUMBER_COERCE_MARKER (marker, 0);
+	  search_regs.end[i] = MATCH_DATA_REG (XINT (marker));
+	}
+      return Qnil;
+    }
+
   if (!LISTP (list))
     list = wrong_type_argument (Qlistp, list, 0);
 
   for (i = 0; i < RE_NREGS; i++)
     {
       marker = Fcar (list);
-      CHECK_MARKER (marker, 0);
-      search_regs.start[i] = marker_position (marker) - 1;
+      CHECK_NUMBER_COERCE_MARKER (marker, 0);
+      search_regs.start[i] = MATCH_DATA_REG (XINT (marker));
       list = Fcdr (list);
 
       marker = Fcar (list);
-      CHECK_MARKER (marker, 0);
-      search_regs.end[i] = marker_position (marker) - 1;
+      CHECK_NUMBER_COERCE_MARKER (marker, 0);
+      search_regs.end[i] = MATCH_DATA_REG (XINT (marker));
       list = Fcdr (list);
     }
 
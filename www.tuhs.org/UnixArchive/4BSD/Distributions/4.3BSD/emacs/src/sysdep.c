@@ -119,7 +119,7 @@ discard_tty_input ()
 {
   TERMINAL buf;
 
-  if (noninteractive)
+  if (noninteractive || virtual_terminal)
     return;
 
   ioctl (0, TIOCGETP, &buf);
@@ -147,6 +147,10 @@ init_baud_rate ()
 
   if (noninteractive)
     ospeed = 0;
+  /* Benchmark runs should not depend on the speed of whatever
+     stdin happens to be, so a virtual terminal is always 9600 baud.  */
+  else if (virtual_terminal)
+    ospeed = B9600;
   else
     {
       ioctl (0, TIOCGETP, &sg);
@@ -377,8 +381,9 @@ init_sys_modes ()
   if (noninteractive)
     return;
 
-  ioctl (0, TIOCGETP, &old_gtty);
-  if (!read_socket_hook)
+  if (!virtual_terminal)
+    ioctl (0, TIOCGETP, &old_gtty);
+  if (!read_socket_hook && !virtual_terminal)
     {
       sg = old_gtty;
 
@@ -489,7 +494,7 @@ init_sys_modes ()
 tabs_safe_p ()
 {
   TERMINAL sg;
-  if (noninteractive)
+  if (noninteractive || virtual_terminal)
     return 1;
   ioctl (0, TIOCGETP, &sg);
   return (TABS_OK(sg));
@@ -513,6 +518,16 @@ get_screen_size (widthp, heightp)
 
 #ifdef TIOCGWINSZ
   struct winsize size;
+#endif /* TIOCGWINSZ */
+
+  if (virtual_terminal)
+    {
+      *widthp = vt_width;
+      *heightp = vt_height;
+      return;
+    }
+
+#ifdef TIOCGWINSZ
   *widthp = 0;
   *heightp = 0;
   if (ioctl (0, TIOCGWINSZ, &size) < 0)
@@ -540,7 +555,7 @@ reset_sys_modes ()
   topos (screen_height - 1, 0);
   reset_terminal_modes ();
   fflush (stdout);
-  if (read_socket_hook)
+  if (read_socket_hook || virtual_terminal)
     return;
 #ifdef TIOCGLTC
   ioctl (0, TIOCSETC, &old_tchars);
@@ -700,6 +715,54 @@ get_system_name ()
 #endif /* not USG */
 }
 
+/* Return the CPU time (user plus system) used by Emacs so far,
+   or the time of day, in microseconds.
+   The values wrap around; only the difference between two
+   values obtained not too far apart is meaningful.  */
+
+#ifdef BSD
+#include <sys/time.h>
+#include <sys/resource.h>
+#else /* not BSD */
+#include <sys/times.h>
+#ifndef HZ
+#define HZ 60
+#endif /* not HZ */
+#endif /* not BSD */
+
+long
+get_cpu_usecs ()
+{
+#ifdef BSD
+  struct rusage ru;
+
+  getrusage (RUSAGE_SELF, &ru);
+  return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000
+	  + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+#else /* not BSD */
+  struct tms t;
+
+  times (&t);
+  return (t.tms_utime + t.tms_stime) * (1000000 / HZ);
+#endif /* not BSD */
+}
+
+long
+get_real_usecs ()
+{
+#ifdef HAVE_TIMEVAL
+  struct timeval tv;
+  struct timezone tz;
+
+  gettimeofday (&tv, &tz);
+  return tv.tv_sec * 1000000 + tv.tv_usec;
+#else /* not HAVE_TIMEVAL */
+  extern long time ();
+
+  return time ((long *) 0) * 1000000;
+#endif /* not HAVE_TIMEVAL */
+}
+
 #ifndef HAVE_SELECT
 
 /* Emulate as much as select as is possible under 4.1 and needed by Gnu Emacs
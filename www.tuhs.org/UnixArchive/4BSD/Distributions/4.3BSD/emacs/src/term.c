@@ -51,6 +51,9 @@ int char_ins_del_ok;		/* Terminal can insert and delete chars */
 int scroll_region_ok;		/* Terminal supports setting the scroll window */
 int memory_below_screen;	/* Terminal remembers lines scrolled off bottom */
 int fast_clear_end_of_line;	/* Terminal has a `ce' string */
+int write_over_blanks;		/* Nonzero means the screen is known to be
+				   blank where write_chars is writing,
+				   so it may skip over blanks.  */
 
 int dont_calculate_costs;	/* Nonzero means don't bother computing */
 				/* various cost tables; we won't use them.  */
@@ -109,6 +112,7 @@ char *TS_del_multi_chars;	/* "DC" (one parameter, # chars to delete) */
 char *TS_del_line;		/* "dl" */
 char *TS_del_multi_lines;	/* "DL" (one parameter, # lines to delete) */
 char *TS_delete_mode;		/* "dm", enter character-delete mode */
+char *TS_erase_chars;		/* "ec" (one parameter, # chars to erase) */
 char *TS_end_delete_mode;	/* "ed", leave character-delete mode */
 char *TS_end_insert_mode;	/* "ei", leave character-insert mode */
 char *TS_ins_char;		/* "ic" */
@@ -143,6 +147,8 @@ int TN_standout_width;		/* termcap sg number: width occupied by standout markers
 
 static int RPov;		/* # chars to start a TS_repeat */
 
+static int ECHov;		/* # chars to send a TS_erase_chars */
+
 static int delete_in_insert_mode;		/* delete mode == insert mode */
 
 static int se_is_so;		/* 1 if same string both enters and leaves standout mode */
@@ -525,6 +531,7 @@ clear_end_of_line_raw (first_unused_hpos)
      int first_unused_hpos;
 {
   register int i;
+  char *buf;
   first_unused_hpos += chars_wasted[curY] & 077;
   if (clear_end_of_line_hook)
     {
@@ -541,6 +548,12 @@ clear_end_of_line_raw (first_unused_hpos)
     {
       OUTPUT1 (TS_clr_line);
     }
+  else if (ECHov < first_unused_hpos - curX && !must_write_spaces)
+    {
+      buf = (char *) alloca (strlen (TS_erase_chars) + 10);
+      tparam (TS_erase_chars, buf, first_unused_hpos - curX);
+      OUTPUT1 (buf);
+    }
   else
     {			/* have to do it the hard way */
       turn_off_insert ();
@@ -554,14 +567,93 @@ clear_end_of_line_raw (first_unused_hpos)
     }
 }
 
+/* Output optimizer.
+   write_run sends a run of identical characters in whichever
+   of these ways costs fewest characters of output:  */
+
+#define RUN_LITERAL 0		/* Send the characters themselves */
+#define RUN_REPEAT 1		/* Send TS_repeat */
+#define RUN_ERASE 2		/* Blanks: TS_erase_chars, then move past */
+#define RUN_SKIP 3		/* Blanks already on screen: just move past */
+
+/* Write `n' copies of the character `*start'.
+   `more' nonzero means more text follows on this line,
+   so it is safe to leave the cursor just past the run.  */
+
+static
+write_run (start, n, more)
+     register char *start;
+     register int n;
+     int more;
+{
+  register int c = *start;
+  register char *buf;
+  int how = RUN_LITERAL;
+  int best = n;
+  int tem;
+
+  if (RPov < best)
+    how = RUN_REPEAT, best = RPov;
+  if (c == ' ' && more && !standout_mode && !must_write_spaces)
+    {
+      tem = cmcost (curY, curX + n);
+      if (write_over_blanks && tem < best)
+	how = RUN_SKIP, best = tem;
+      if (ECHov + tem < best)
+	how = RUN_ERASE, best = ECHov + tem;
+    }
+
+  switch (how)
+    {
+    case RUN_REPEAT:
+      buf = (char *) alloca (strlen (TS_repeat) + 10);
+      tparam (TS_repeat, buf, c, n);
+      tputs (buf, n, cmputc);
+      cmplus (n);
+      break;
+
+    case RUN_ERASE:
+      buf = (char *) alloca (strlen (TS_erase_chars) + 10);
+      tparam (TS_erase_chars, buf, n);
+      OUTPUT1 (buf);
+      /* Erasing does not move the cursor; so fall through.  */
+    case RUN_SKIP:
+      cmgoto (curY, curX + n);
+      break;
+
+    default:
+      cmplus (n);
+      if (!TF_underscore && !TF_hazeltine)
+	{
+	  fwrite (start, 1, n, stdout);
+	  if (ferror (stdout))
+	    clearerr (stdout);
+	  if (termscript)
+	    fwrite (start, 1, n, termscript);
+	  break;
+	}
+      while (--n >= 0)
+	{
+	  if (c == '_' && TF_underscore)
+	    {
+	      if (termscript)
+		fputc (' ', termscript);
+	      putchar (' ');
+	      OUTPUT (Left);
+	    }
+	  if (termscript)
+	    fputc (TF_hazeltine && c == '~' ? '`' : c, termscript);
+	  putchar (TF_hazeltine && c == '~' ? '`' : c);
+	}
+    }
+}
+
 write_chars (start, len)
      register char *start;
      int len;
 {
   register char *p;
   register int n;
-  register char *buf;
-  register int c;
 
   if (write_chars_hook)
     {
@@ -577,51 +669,29 @@ write_chars (start, len)
       && curX + len == screen_width)
     len --;
 
-  cmplus (len);
-
-  if (RPov > len && !TF_underscore && !TF_hazeltine)
+  /* If no run could be cheaper than sending its characters,
+     send them all at once.  */
+  if (RPov > len && ECHov > len && !write_over_blanks
+      && !TF_underscore && !TF_hazeltine)
     {
+      cmplus (len);
       fwrite (start, 1, len, stdout);
       if (ferror (stdout))
 	clearerr (stdout);
       if (termscript)
 	fwrite (start, 1, len, termscript);
+      return;
+    }
+
+  while (len > 0)
+    {
+      /* n is number of identical chars in this run */
+      for (p = start + 1; p < start + len && *p == *start; p++);
+      n = p - start;
+      write_run (start, n, n < len);
+      start += n;
+      len -= n;
     }
-  else
-    while (--len >= 0)
-      {
-	if (RPov + 1 < len && *start == start[1])
-	  {
-	    p = start + 1;
-
-	    /* Now, len is number of chars left starting at p */
-	    while (*p++ == *start);
-	    /* n is number of identical chars in this run */
-	    n = p - start;
-	    if (n > RPov)
-	      {
-		buf = (char *) alloca (strlen (TS_repeat) + 10);
-		tparam (TS_repeat, buf, *start, n);
-		tputs (buf, n, cmputc);
-		start = p;
-		len -= n - 1;
-		continue;
-	      }
-	  }
-	c = *start++;
-	if (c == '_' && TF_underscore)
-	  {
-	    if (termscript)
-	      fputc (' ', termscript);
-	    putchar (' ');
-	    OUTPUT (Left);
-	  }
-	if (TF_hazeltine && c == '~')
-	  c = '`';
-	if (termscript)
-	  fputc (c, termscript);
-	putchar (c);
-      }
 }
 
 /* If start is zero, insert blanks instead of a string at start */
@@ -918,6 +988,12 @@ calculate_costs ()
   else
     RPov = MScreenWidth;
 
+  /* Likewise for TS_erase_chars */
+  if (TS_erase_chars && per_line_cost (TS_erase_chars) * baud_rate < 9000)
+    ECHov = string_cost (TS_erase_chars);
+  else
+    ECHov = MScreenWidth;
+
   cmcostinit ();		/* set up cursor motion costs */
 }
 
@@ -964,6 +1040,7 @@ term_init (terminal_type)
   TS_del_line = tgetstr ("dl", &fill);
   TS_del_multi_lines = tgetstr ("DL", &fill);
   TS_delete_mode = tgetstr ("dm", &fill);
+  TS_erase_chars = tgetstr ("ec", &fill);
   TS_end_delete_mode = tgetstr ("ed", &fill);
   TS_end_insert_mode = tgetstr ("ei", &fill);
   Home = tgetstr ("ho", &fill);
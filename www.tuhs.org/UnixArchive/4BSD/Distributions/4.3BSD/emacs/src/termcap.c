@@ -44,22 +44,24 @@ memory_out ()
   exit (1);
 }
 
-static int
+static char *
 xmalloc (size)
      int size;
 {
-  register tem = malloc (size);
+  extern char *malloc ();
+  register char *tem = malloc (size);
   if (!tem)
     memory_out ();
   return tem;
 }
 
-static int
+static char *
 xrealloc (ptr, size)
-     int ptr;
+     char *ptr;
      int size;
 {
-  register tem = realloc (ptr, size);
+  extern char *realloc ();
+  register char *tem = realloc (ptr, size);
   if (!tem)
     memory_out ();
   return tem;
@@ -291,8 +293,9 @@ tgetent (bp, name)
   char *term;
   int malloc_size = 0;
   register int c;
+  extern char *getenv ();
 
-  tem = (char *) getenv ("TERMCAP");
+  tem = getenv ("TERMCAP");
 
   /* If tem is non-null and starts with /,
      it is a file name to use instead of /etc/termcap.
@@ -33,6 +33,7 @@ extern int char_ins_del_ok;	/* Terminal can insert and delete chars */
 extern int scroll_region_ok;	/* Terminal supports setting the scroll window */
 extern int memory_below_screen;	/* Terminal remembers lines scrolled off bottom */
 extern int fast_clear_end_of_line; /* Terminal has a `ce' string */
+extern int write_over_blanks;	/* Screen is blank where write_chars writes */
 
 extern int dont_calculate_costs; /* Nonzero means don't bother computing */
 				/* various cost tables; we won't use them.  */
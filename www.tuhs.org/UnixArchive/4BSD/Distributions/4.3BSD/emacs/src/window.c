@@ -81,11 +81,13 @@ make_window ()
   Lisp_Object val;
   register struct window *p;
 
+  /* struct Lisp_Vector includes one element of contents; count it.  */
   val = Fmake_vector (
     make_number ((sizeof (struct window) - sizeof (struct Lisp_Vector))
-		 / sizeof (Lisp_Object)),
+		 / sizeof (Lisp_Object) + 1),
     Qnil);
   XSETTYPE (val, Lisp_Window);
+  remember_always (val);
   p = XWINDOW (val);
   XFASTINT (p->left) = XFASTINT (p->top)
     = XFASTINT (p->height) = XFASTINT (p->width)
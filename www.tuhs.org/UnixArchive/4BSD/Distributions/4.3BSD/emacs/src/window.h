@@ -134,6 +134,10 @@ struct window
     Lisp_Object window_end_vpos;
     /* Non-nil means must regenerate mode line of this window */
     Lisp_Object redo_mode_line;
+    /* Text of this window's mode line as last displayed, or nil */
+    Lisp_Object mode_line_cache;
+    /* Vector of the values that text was made from; see xdisp.c */
+    Lisp_Object mode_line_inputs;
   };
 
 /* This is the window which displays the minibuffer.
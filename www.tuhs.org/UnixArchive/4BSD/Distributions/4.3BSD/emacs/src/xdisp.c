@@ -91,6 +91,15 @@ int blank_end_of_window;
 /* Number of windows showing the buffer of the selected window.  */
 static int buffer_shared;
 
+/* Window that redisplay_all_windows has already done out of turn.  */
+static struct window *first_window;
+
+/* Nonzero once redisplay_all_windows has done the selected window.  */
+static int selected_done;
+
+/* Nonzero if redisplay_windows gave up because input arrived.  */
+static int layout_preempted;
+
 /* display_text_line sets these to the screen position (origin 0) of point,
   whether the window is selected or not.
  Set one to -1 first to determine whether point was found afterwards.  */
@@ -258,6 +267,11 @@ DoDsp (SaveMiniBuf)
   if (noninteractive)
     return;
 
+  redisplay_count++;
+  layout_preempted = 0;
+  if (redisplay_time_budget > 0)
+    redisplay_start_time = get_real_usecs ();
+
   if (screen_garbaged)
     {
       Fredraw_display ();
@@ -370,6 +384,17 @@ DoDsp (SaveMiniBuf)
 update: 
   pause = update_screen (0, inhibit_hairy_id);
 
+  /* Count each preempted redisplay once.  After a layout preempt,
+     update_screen did only the selected window, and the windows
+     that were not laid out are still out of date.  */
+  if (layout_preempted)
+    {
+      redisplay_layout_preempts++;
+      pause = 1;
+    }
+  else if (pause)
+    redisplay_output_preempts++;
+
   /* If screen does not match, prevent doing single-line-update next time */
   if (pause)
     this_line_bufpos = 0;
@@ -452,15 +477,52 @@ int do_id = 1;
 redisplay_all_windows ()
 {
   buffer_shared = 0;
+  first_window = 0;
+  selected_done = 0;
+
+  /* Do the selected window first, so it is ready if we are preempted.
+     Only a full width window can be done out of turn, since
+     display lines must be filled in from left to right.  */
+  if (XFASTINT (XWINDOW (selected_window)->width) == screen_width)
+    {
+      redisplay_window (selected_window, 0);
+      first_window = XWINDOW (selected_window);
+      selected_done = 1;
+    }
 
   redisplay_windows (XWINDOW (minibuf_window)->prev);
+
+  /* If input stopped the layout, the selected window must still be
+     finished.  Since the windows to the right of it were not laid
+     out, keep what the screen already shows in the other columns.  */
+  if (layout_preempted)
+    {
+      register struct window *w = XWINDOW (selected_window);
+
+      if (!selected_done)
+	redisplay_window (selected_window, 0);
+      if (XFASTINT (w->width) != screen_width)
+	preserve_other_columns (w);
+    }
 }
 
 redisplay_windows (window)
      Lisp_Object window;
 {
   for (; !NULL (window); window = XWINDOW (window)->next)
-    redisplay_window (window, 0);
+    {
+      if (layout_preempted)
+	return;
+      if (redisplay_over_budget () && detect_input_pending ())
+	{
+	  layout_preempted = 1;
+	  return;
+	}
+      if (XWINDOW (window) != first_window)
+	redisplay_window (window, 0);
+      if (EQ (window, selected_window))
+	selected_done = 1;
+    }
 }
 
 redisplay_window (window, just_this_one)
@@ -1316,17 +1378,204 @@ display_text_line (w, start, vpos, hpos, taboffset)
   return &val_display_text_line;
 }
 
+/* Mode line caching.
+
+ display_mode_line saves the text of each window's mode line
+ in w->mode_line_cache, and in the vector w->mode_line_inputs
+ the values that text was computed from.  decode_mode_spec records
+ in mode_line_deps which kinds of % constructs the format used,
+ so that only the inputs of those need be compared next time.
+ If none has changed, the saved text is used as it stands.
+
+ Lisp values are compared with EQ, except that the minor mode lists
+ are saved as copies and compared element by element, since they are
+ altered in place with delq.  Altering an element itself is not
+ noticed until some window or buffer change forces all mode lines
+ to be recomputed.  */
+
+/* Indices in mode_line_inputs.  */
+
+#define MLI_DEPS 0		/* mode_line_deps bits */
+#define MLI_FORMAT 1
+#define MLI_BUFFER 2
+#define MLI_LEFT 3
+#define MLI_WIDTH 4
+#define MLI_NAME 5		/* %b */
+#define MLI_FILENAME 6		/* %f */
+#define MLI_MODE_NAME 7		/* %m */
+#define MLI_MINOR_MODES 8
+#define MLI_GLOBAL_MINOR_MODES 9
+#define MLI_MODE_FLAGS 10	/* Narrow and Def */
+#define MLI_GLOBAL_MODE_STRING 11 /* %M */
+#define MLI_MODIFIED 12		/* %* */
+#define MLI_PERCENT 13		/* %p */
+#define MLI_PROCESS 14		/* %s */
+#define MLI_DEPTH 15		/* %[ and %] */
+#define MLI_SIZE 16
+
+/* Bits in mode_line_deps.  */
+
+#define MLD_NAME 1
+#define MLD_FILENAME 2
+#define MLD_MODES 4
+#define MLD_GLOBAL_MODE_STRING 010
+#define MLD_MODIFIED 020
+#define MLD_PERCENT 040
+#define MLD_PROCESS 0100
+#define MLD_DEPTH 0200
+
+static int mode_line_deps;
+
+/* Inputs of the mode line being displayed, as of now.  */
+
+static Lisp_Object mode_line_now[MLI_SIZE];
+
+/* Return the code for what %p shows in window w:
+ -1 for All, -2 for Bottom, -3 for Top, else a percentage.  */
+
+static int
+mode_line_percent (w)
+     struct window *w;
+{
+  int pos = marker_position (w->start);
+  int total = NumCharacters + 1 - FirstCharacter;
+
+  if ((XFASTINT (w->window_end_pos) < 0
+       ? -1 - XFASTINT (w->window_end_pos)
+       : XFASTINT (w->window_end_pos))
+      <= bf_tail_clip)
+    return pos <= FirstCharacter ? -1 : -2;
+  if (pos <= FirstCharacter)
+    return -3;
+  total = ((pos - FirstCharacter) * 100 + total - 1) / total;
+  /* We can't normally display a 3-digit number,
+     so get us a 2-digit number that is close.  */
+  return total == 100 ? 99 : total;
+}
+
+/* Return nonzero if the lists l1 and l2 have the same elements.  */
+
+static int
+same_elements (l1, l2)
+     register Lisp_Object l1, l2;
+{
+  while (XTYPE (l1) == Lisp_Cons && XTYPE (l2) == Lisp_Cons)
+    {
+      if (!EQ (XCONS (l1)->car, XCONS (l2)->car))
+	return 0;
+      l1 = XCONS (l1)->cdr;
+      l2 = XCONS (l2)->cdr;
+    }
+  return EQ (l1, l2);
+}
+
+/* Store in mode_line_now the values the mode line of window w
+ would be made from now, for the kinds of constructs in `deps'.
+ The other slots are set to nil.  */
+
+static
+get_mode_line_inputs (w, deps)
+     struct window *w;
+     int deps;
+{
+  register Lisp_Object *v = mode_line_now;
+  register int i;
+  Lisp_Object proc;
+
+  for (i = 0; i < MLI_SIZE; i++)
+    v[i] = Qnil;
+
+  v[MLI_DEPS] = make_number (deps);
+  v[MLI_FORMAT] = bf_cur->mode_line_format;
+  v[MLI_BUFFER] = w->buffer;
+  v[MLI_LEFT] = w->left;
+  v[MLI_WIDTH] = w->width;
+  if (deps & MLD_NAME)
+    v[MLI_NAME] = bf_cur->name;
+  if (deps & MLD_FILENAME)
+    v[MLI_FILENAME] = bf_cur->filename;
+  if (deps & MLD_MODES)
+    {
+      v[MLI_MODE_NAME] = bf_cur->mode_name;
+      v[MLI_MINOR_MODES] = bf_cur->minor_modes;
+      v[MLI_GLOBAL_MINOR_MODES] = Vglobal_minor_modes;
+      v[MLI_MODE_FLAGS]
+	= make_number ((bf_head_clip > 1 || bf_tail_clip > 0)
+		       + 2 * (defining_kbd_macro != 0));
+    }
+  if (deps & MLD_GLOBAL_MODE_STRING)
+    v[MLI_GLOBAL_MODE_STRING] = Vglobal_mode_string;
+  if (deps & MLD_MODIFIED)
+    v[MLI_MODIFIED]
+      = make_number (!NULL (bf_cur->read_only) ? 2
+		     : bf_modified > bf_cur->save_modified);
+  if (deps & MLD_PERCENT)
+    v[MLI_PERCENT] = make_number (mode_line_percent (w));
+#ifdef subprocesses
+  if (deps & MLD_PROCESS)
+    {
+      proc = Fget_buffer_process (Fcurrent_buffer ());
+      if (!NULL (proc))
+	v[MLI_PROCESS] = Fprocess_status (proc);
+    }
+#endif /* subprocesses */
+  if (deps & MLD_DEPTH)
+    v[MLI_DEPTH] = make_number (RecurseDepth - MinibufDepth);
+}
+
 /* Display the mode line for window w */
 
 display_mode_line (w)
      struct window *w;
 {
   int vpos = XFASTINT (w->height) + XFASTINT (w->top) - 1;
-  struct display_line *line = get_display_line (vpos, XFASTINT (w->left));
-
+  int left = XFASTINT (w->left);
+  struct display_line *line = get_display_line (vpos, left);
   register unsigned char *s = XSTRING (bf_cur->mode_line_format)->data;
+  register Lisp_Object *saved;
+  register int i;
+  int len;
 
-  display_string (w, line, s, XFASTINT (w->left), 0, 1);
+  /* If the inputs are all as they were last time,
+     just copy the text we made then.  */
+  if (!NULL (w->mode_line_cache) && !windows_or_buffers_changed)
+    {
+      saved = XVECTOR (w->mode_line_inputs)->contents;
+      get_mode_line_inputs (w, XFASTINT (saved[MLI_DEPS]));
+      for (i = 0; i < MLI_SIZE; i++)
+	if (i == MLI_MINOR_MODES || i == MLI_GLOBAL_MINOR_MODES
+	    ? !same_elements (mode_line_now[i], saved[i])
+	    : !EQ (mode_line_now[i], saved[i]))
+	  break;
+      if (i == MLI_SIZE)
+	{
+	  len = XSTRING (w->mode_line_cache)->size;
+	  bcopy (XSTRING (w->mode_line_cache)->data, line->body + left, len);
+	  line->length = max (line->length, left + len);
+	  line->body[line->length] = 0;
+	  goto highlight;
+	}
+    }
+
+  mode_line_deps = 0;
+  len = display_string (w, line, s, left, 0, 1) - left;
+
+  /* Save the text and what it depended on.  */
+  get_mode_line_inputs (w, mode_line_deps);
+  if (NULL (w->mode_line_inputs))
+    w->mode_line_inputs = Fmake_vector (make_number (MLI_SIZE), Qnil);
+  for (i = MLI_MINOR_MODES; i <= MLI_GLOBAL_MINOR_MODES; i++)
+    if (XTYPE (mode_line_now[i]) == Lisp_Cons)
+      mode_line_now[i] = Fcopy_sequence (mode_line_now[i]);
+  bcopy (mode_line_now, XVECTOR (w->mode_line_inputs)->contents,
+	 sizeof mode_line_now);
+  remember_object (w->mode_line_inputs);
+  if (NULL (w->mode_line_cache) || XSTRING (w->mode_line_cache)->size != len)
+    w->mode_line_cache = make_string (line->body + left, len);
+  else
+    bcopy (line->body + left, XSTRING (w->mode_line_cache)->data, len);
+
+ highlight:
   /* Make the mode line inverse video if the entire line
      is made of mode lines.
      I.e. if this window is full width,
@@ -1394,6 +1643,7 @@ decode_mode_spec (w, string, data_ptr, len_ptr, max_ptr)
   switch (c)
     {
     case 'b': 
+      mode_line_deps |= MLD_NAME;
       lstr = bf_cur->name;
       if (width && XSTRING (lstr)->size > width)
 	width = min (2 * width, XSTRING (lstr)->size);
@@ -1407,6 +1657,7 @@ decode_mode_spec (w, string, data_ptr, len_ptr, max_ptr)
       break;
 
     case 'f': 
+      mode_line_deps |= MLD_FILENAME;
       if (NULL (bf_cur->filename))
 	str = "[none]";
       else if (XTYPE (bf_cur->filename) == Lisp_String)
@@ -1414,6 +1665,7 @@ decode_mode_spec (w, string, data_ptr, len_ptr, max_ptr)
       break;
 
     case 'm': 
+      mode_line_deps |= MLD_MODES;
       lstr = bf_cur->mode_name;
       total = min (XSTRING (lstr)->size, tbufsize - 30);
       if (total < 0) total = 0;
@@ -1458,16 +1710,19 @@ decode_mode_spec (w, string, data_ptr, len_ptr, max_ptr)
       break;
 
     case 'M': 
+      mode_line_deps |= MLD_GLOBAL_MODE_STRING;
       lstr = Vglobal_mode_string;
       break;
 
     case '*': 
+      mode_line_deps |= MLD_MODIFIED;
       str = !NULL (bf_cur->read_only) ? "%"
 	    : bf_modified > bf_cur->save_modified ? "*" :"-";
       break;
 
     case 's':
       /* status of process */
+      mode_line_deps |= MLD_PROCESS;
 #ifdef subprocesses
       proc = Fget_buffer_process (Fcurrent_buffer ());
       if (NULL (proc))
@@ -1480,40 +1735,30 @@ decode_mode_spec (w, string, data_ptr, len_ptr, max_ptr)
       break;
 
     case 'p':
-      pos = marker_position (w->start);
-      total = NumCharacters + 1 - FirstCharacter;
-
-      if ((XFASTINT (w->window_end_pos) < 0
-	   ? -1 - XFASTINT (w->window_end_pos)
-	   : XFASTINT (w->window_end_pos))
-	  <= bf_tail_clip)
-	{
-	  if (pos <= FirstCharacter)
-	    str = "All";
-	  else
-	    str = "Bottom";
-	}
-      else if (pos <= FirstCharacter)
+      mode_line_deps |= MLD_PERCENT;
+      total = mode_line_percent (w);
+      if (total == -1)
+	str = "All";
+      else if (total == -2)
+	str = "Bottom";
+      else if (total == -3)
 	str = "Top";
       else
 	{
-	  total = ((pos - FirstCharacter) * 100 + total - 1) / total;
-	  /* We can't normally display a 3-digit number,
-	     so get us a 2-digit number that is close.  */
-	  if (total == 100)
-	    total = 99;
 	  sprintf (tbuf, "%2d%%", total);
 	  str = tbuf;
 	}
       break;
 
     case '[': 
+      mode_line_deps |= MLD_DEPTH;
       str = "[[[[[[[[[[" + 10 - (RecurseDepth - MinibufDepth);
       if (RecurseDepth - MinibufDepth > 10)
 	str = "[[[... ";
       break;
 
     case ']': 
+      mode_line_deps |= MLD_DEPTH;
       str = "]]]]]]]]]]" + 10 - (RecurseDepth - MinibufDepth);
       if (RecurseDepth - MinibufDepth > 10)
 	str = " ...]]]";